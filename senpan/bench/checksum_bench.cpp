@@ -0,0 +1,188 @@
+#include "../include/checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ******************************************************************
+ CHECKSUM MICROBENCHMARK
+
+   With a payload size, times each checksum over packets with that
+   much payload in use: the original 8-bit sum, the Internet checksum,
+   and CRC32C with the table and, where the CPU has it, SSE4.2.  The
+   report shows MB/s and ns per packet.
+
+   With -d, corrupts random packets the way the emulator does and by
+   flipping random bits, and counts the corruptions each checksum lets
+   through.  Bits are flipped by flip_bits(), as --bitflip flips them,
+   anywhere in the header and the payload in use.
+**********************************************************************/
+
+#define BENCH_BYTES (32 << 20)
+#define TRIALS 200000
+
+long long now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+volatile uint32_t sink;
+SimRandom *rng;
+
+/* CRC32C of a packet with one implementation, as paket_checksum() */
+/* computes it with the other                                      */
+uint32_t crc32c_paket(uint32_t (*crc)(uint32_t, const void *, size_t), const struct pkt &p)
+{
+  int32_t head[3] = {p.seqnum, p.acknum, p.length};
+  return crc(crc(0, head, sizeof(head)), p.payload, p.length > 20 ? p.length : 20);
+}
+
+/* ns per packet of one checksum */
+template <class Checksum>
+double time_checksum(const struct pkt &p, long n, Checksum sum)
+{
+  uint32_t acc = 0;
+  long long start = now_ns();
+  for (long i = 0; i < n; i++)
+    acc += sum(p);
+  long long ns = now_ns() - start;
+  sink = acc;
+  return (double)ns / n;
+}
+
+uint32_t by_sum8(const struct pkt &p) { return paket_checksum(CHECKSUM_SUM8, p); }
+uint32_t by_inet(const struct pkt &p) { return paket_checksum(CHECKSUM_INET, p); }
+uint32_t by_table(const struct pkt &p) { return crc32c_paket(crc32c_table, p); }
+uint32_t by_hardware(const struct pkt &p) { return crc32c_paket(crc32c_hardware, p); }
+
+void throughput(int size)
+{
+  struct pkt p;
+  memset(&p, 0, sizeof(p));
+  p.length = size;
+  for (int i = 0; i < size; i++)
+    p.payload[i] = rand();
+
+  long n = BENCH_BYTES / (size > 20 ? size : 20);
+  double sum8 = time_checksum(p, n, by_sum8);
+  double inet = time_checksum(p, n, by_inet);
+  double table = time_checksum(p, n, by_table);
+  double hardware = crc32c_hardware != NULL ? time_checksum(p, n, by_hardware) : 0;
+  printf("[BENCH]payload %d ns/pkt sum8 %.1f inet %.1f crc32c-table %.1f", size, sum8, inet, table);
+  if (crc32c_hardware != NULL)
+    printf(" crc32c-sse4.2 %.1f", hardware);
+  printf(" MB/s sum8 %.0f inet %.0f crc32c-table %.0f", size * 1000.0 / sum8, size * 1000.0 / inet,
+         size * 1000.0 / table);
+  if (crc32c_hardware != NULL)
+    printf(" crc32c-sse4.2 %.0f", size * 1000.0 / hardware);
+  printf("[/BENCH]\n");
+}
+
+/* a data packet of size payload bytes: one message of the emulator's */
+/* letters in the original format, framed messages otherwise          */
+void random_paket(struct pkt &p, int size)
+{
+  memset(&p, 0, sizeof(p));
+  p.seqnum = rand() % 64;
+  p.acknum = rand() % 64;
+  p.length = size;
+  memset(p.payload, 'a' + rand() % 26, size);
+  if (size > 20)
+    for (int at = 0; at + 2 <= size; at += 22)
+    {
+      p.payload[at] = (size - at - 2 < 20 ? size - at - 2 : 20);
+      p.payload[at + 1] = 0;
+    }
+}
+
+/* the emulator's corruption, see tolayer3() */
+void corrupt_emulator(struct pkt &p)
+{
+  float x = rand() / (float)RAND_MAX;
+  if (x < .75)
+    p.payload[0] = 'Z';
+  else if (x < .875)
+    p.seqnum = 999999;
+  else
+    p.acknum = 999999;
+}
+
+/* a burst: bits flipped at random within 16 in a row, the first and */
+/* last always                                                        */
+void corrupt_burst(struct pkt &p)
+{
+  int size = p.length > 20 ? p.length : 20;
+  int start = rand() % (8 * size - 15);
+  for (int b = start; b < start + 16; b++)
+    if (b == start || b == start + 15 || rand() % 2)
+      p.payload[b / 8] ^= 1 << (b % 8);
+}
+
+void detection(const char *model, int size, int bits)
+{
+  long undetected[3] = {0, 0, 0};
+  long trials = 0;
+  struct pkt p, q;
+
+  for (long t = 0; t < TRIALS; t++)
+  {
+    random_paket(p, size);
+    q = p;
+    if (bits == 0)
+      corrupt_emulator(q);
+    else if (bits < 0)
+      corrupt_burst(q);
+    else
+      flip_bits(q, PKT_HEADER + q.length, bits, rng);
+    if (memcmp(&p, &q, sizeof(p)) == 0)
+      continue;      /* nothing changed */
+    trials++;
+    /* the flips of the checksum field apply to whichever checksum */
+    /* the sender put there                                        */
+    int flipped = p.checksum ^ q.checksum;
+    for (int kind = 0; kind < 3; kind++)
+      if ((paket_checksum(kind, p) ^ flipped) == paket_checksum(kind, q))
+        undetected[kind]++;
+  }
+  printf("[BENCH]detect %s payload %d corrupted %ld undetected", model, size, trials);
+  for (int kind = 0; kind < 3; kind++)
+    printf(" %s %ld (%.4f%%)", checksum_names[kind], undetected[kind], 100.0 * undetected[kind] / trials);
+  printf("[/BENCH]\n");
+}
+
+int main(int argc, char **argv)
+{
+  srand(1);
+  rng = make_random("xoshiro", 1);
+  if (argc == 2 && strcmp(argv[1], "-d") == 0)
+  {
+    int sizes[] = {20, 256};
+    for (int i = 0; i < 2 && sizes[i] <= PKT_MAX_PAYLOAD; i++)
+    {
+      detection("emulator", sizes[i], 0);
+      detection("1-bit", sizes[i], 1);
+      detection("2-bit", sizes[i], 2);
+      detection("3-bit", sizes[i], 3);
+      detection("4-bit", sizes[i], 4);
+      detection("burst-16", sizes[i], -1);
+    }
+    return 0;
+  }
+
+  if (argc != 2 || atoi(argv[1]) < 1 || atoi(argv[1]) > PKT_MAX_PAYLOAD)
+  {
+    fprintf(stderr, "Usage:\n %s Payload size (up to %d)\n %s -d\n", argv[0], PKT_MAX_PAYLOAD, argv[0]);
+    return -1;
+  }
+  /* the standard check value of CRC32C */
+  if (crc32c_table(0, "123456789", 9) != 0xe3069283 ||
+      (crc32c_hardware != NULL && crc32c_hardware(0, "123456789", 9) != 0xe3069283))
+  {
+    fprintf(stderr, "CRC32C check value mismatch\n");
+    return -1;
+  }
+  throughput(atoi(argv[1]));
+  return 0;
+}
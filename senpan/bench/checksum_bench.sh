@@ -0,0 +1,17 @@
+#!/bin/bash
+
+#Title           :checksum_bench.sh
+#description     :Runs the checksum microbenchmark over growing payloads,
+#                 then counts the corruptions each checksum misses.
+#Usage           :bench/checksum_bench.sh
+#====================================================================================
+
+cd "$(dirname "$0")/.."
+make -s bench_checksum || exit 1
+
+# payloads over 20 bytes need a build with room for them:
+#   make clean && make PKT_MAX_PAYLOAD=1500
+for SIZE in 20 64 256 512 1024 1500; do
+    ./bench_checksum $SIZE || break
+done
+./bench_checksum -d
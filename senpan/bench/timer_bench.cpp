@@ -0,0 +1,107 @@
+#include "../include/simulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ******************************************************************
+ TIMER MICROBENCHMARK
+
+   Built in place of a protocol and driven by the normal simulator.
+   A keeps exactly -w packets in flight and, like GBN and SR, stops and
+   restarts its timer on every ACK.  Only the stoptimer()/starttimer()
+   pair is timed, so the report shows the per-ACK timer cost against
+   the number of events pending in the simulator.
+**********************************************************************/
+
+long long now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class TimerBench : public Protocol
+{
+  public:
+    TimerBench(struct sim_context *_sim)
+      : Protocol(_sim), inflight(0), wind_size(0), timer_running(0), acks(0), timer_ns(0) {};
+    ~TimerBench()
+    {
+      printf("[BENCH]window %d acks %ld ns/ack %lld[/BENCH]\n",
+             wind_size, acks, acks ? timer_ns / acks : 0);
+    }
+
+    void A_output(const struct msg &message);
+    void A_input(const struct pkt &packet);
+    void A_timerinterrupt();
+    void A_init();
+    void B_input(const struct pkt &packet);
+    void B_init();
+
+  private:
+    int inflight;
+    int wind_size;
+    int timer_running;
+    long acks;
+    long long timer_ns;
+
+    void send_one();
+};
+
+void TimerBench::send_one()
+{
+  struct pkt p;
+  memset(&p, 0, sizeof(p));
+  tolayer3(sim, 0, p);
+  inflight++;
+}
+
+void TimerBench::A_output(const struct msg & /*message*/)
+{
+  while(inflight < wind_size)
+    send_one();
+  if(!timer_running)
+  {
+    starttimer(sim, 0, 20);
+    timer_running = 1;
+  }
+}
+
+void TimerBench::A_input(const struct pkt & /*packet*/)
+{
+  long long start = now_ns();
+  stoptimer(sim, 0);
+  starttimer(sim, 0, 20);
+  timer_ns += now_ns() - start;
+  acks++;
+
+  inflight--;
+  send_one();
+}
+
+void TimerBench::A_timerinterrupt()
+{
+  timer_running = 0;
+}
+
+void TimerBench::A_init()
+{
+  wind_size = getwinsize(sim);
+}
+
+void TimerBench::B_input(const struct pkt &packet)
+{
+  tolayer3(sim, 1, packet);
+}
+
+void TimerBench::B_init()
+{
+}
+
+const char *const protocol_names[] = { "timer", NULL };
+
+Protocol *make_protocol(const char * /*name*/, struct sim_context *sim)
+{
+  return new TimerBench(sim);
+}
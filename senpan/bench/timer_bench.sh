@@ -0,0 +1,16 @@
+#!/bin/bash
+
+#Title           :timer_bench.sh
+#description     :Runs the timer microbenchmark over growing windows.
+#                 With O(1) timer handles ns/ack should stay flat.
+#Usage           :bench/timer_bench.sh [event queue engine]
+#====================================================================================
+
+ENGINE=${1:-heap}
+
+cd "$(dirname "$0")/.."
+make -s bench_timer || exit 1
+
+for WIN in 8 64 512 4096 32768; do
+    ./bench_timer -s 1 -m 20 -t 1000 -c 0 -l 0 -w $WIN -v 0 -e $ENGINE | grep BENCH
+done
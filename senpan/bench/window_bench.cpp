@@ -0,0 +1,186 @@
+#include "../include/send_window.h"
+#include "../include/timing_wheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+/* ******************************************************************
+ SR SENDER WINDOW MICROBENCHMARK
+
+   Keeps a full window of w packets in flight.  Each operation ACKs a
+   random packet of the window, sends a new one and lets every timer
+   that is due by then expire and retransmit.  Timeouts vary between
+   w/2 and w time units, so some packets do time out.  The same run is
+   replayed against two sender windows: per-packet vectors with a
+   sorted timer list, scanned and erased from as sr.cpp used to, and
+   SendWindow with a TimingWheel.  The report shows the cost per
+   operation as the window grows.
+**********************************************************************/
+
+#define OPS 20000
+
+long long now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* the old sender state: resend buffer and a timer list kept in order */
+class VectorWindow
+{
+  public:
+    struct timer {
+      float time;
+      int seqnum;
+    };
+    std::vector<struct pkt> resend_buffer;
+    std::vector<struct timer> timer_list;
+    long resent;
+
+    VectorWindow() : resent(0) {};
+
+    void arm(int seqnum, float time)
+    {
+      struct timer t = { time, seqnum };
+      size_t i = timer_list.size();
+      while (i > 0 && timer_list[i-1].time > time)
+        i--;
+      timer_list.insert(timer_list.begin() + i, t);
+    }
+
+    void send(const struct pkt &p, float time)
+    {
+      resend_buffer.push_back(p);
+      arm(p.seqnum, time);
+    }
+
+    void ack(int seqnum)
+    {
+      for (size_t i = 0; i < resend_buffer.size(); i++)
+        if (resend_buffer[i].seqnum == seqnum)
+        {
+          resend_buffer.erase(resend_buffer.begin() + i);
+          break;
+        }
+      for (size_t i = 0; i < timer_list.size(); i++)
+        if (timer_list[i].seqnum == seqnum)
+        {
+          timer_list.erase(timer_list.begin() + i);
+          break;
+        }
+    }
+
+    template <class Timeout>
+    void expire(float now, Timeout timeout)
+    {
+      while (!timer_list.empty() && timer_list[0].time <= now)
+      {
+        int seqnum = timer_list[0].seqnum;
+        timer_list.erase(timer_list.begin());
+        for (size_t i = 0; i < resend_buffer.size(); i++)
+          if (resend_buffer[i].seqnum == seqnum)
+          {
+            resent++;
+            break;
+          }
+        arm(seqnum, now + timeout());
+      }
+    }
+};
+
+/* the same interface over SendWindow and TimingWheel */
+class IndexedWindow
+{
+  public:
+    SendWindow window;
+    TimingWheel timers;
+    std::vector<int> expired;
+    long resent;
+
+    IndexedWindow(int max_seqnum) : window(max_seqnum), timers(max_seqnum, 1.0), resent(0) {};
+
+    void send(const struct pkt &p, float time)
+    {
+      window.add(p);
+      timers.arm(p.seqnum, time);
+    }
+
+    void ack(int seqnum)
+    {
+      window.ack(seqnum);
+      timers.cancel(seqnum);
+    }
+
+    template <class Timeout>
+    void expire(float now, Timeout timeout)
+    {
+      expired.clear();
+      timers.advance(now, expired);
+      for (size_t i = 0; i < expired.size(); i++)
+      {
+        if (window.contains(expired[i]))
+          resent++;
+        timers.arm(expired[i], now + timeout());
+      }
+    }
+};
+
+int w;
+
+float timeout()
+{
+  return w / 2 + rand() % (w / 2 + 1);
+}
+
+/* fill a window of w packets, then time OPS operations on it */
+template <class Window>
+long long run(Window &win)
+{
+  std::vector<int> inflight;
+  struct pkt p;
+  float clock = 0;
+
+  memset(&p, 0, sizeof(p));
+  srand(1);
+  for (int i = 0; i < w; i++)
+  {
+    p.seqnum = i;
+    win.send(p, clock + timeout());
+    inflight.push_back(i);
+  }
+
+  long long start = now_ns();
+  for (int op = 0; op < OPS; op++)
+  {
+    clock += 1;
+    /* ACK a random packet and reuse its slot for the next one */
+    int pos = rand() % inflight.size();
+    win.ack(inflight[pos]);
+    p.seqnum = inflight[pos];
+    win.send(p, clock + timeout());
+    win.expire(clock, timeout);
+  }
+  return now_ns() - start;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2 || atoi(argv[1]) < 1)
+  {
+    fprintf(stderr, "Usage:\n %s Window size\n", argv[0]);
+    return -1;
+  }
+  w = atoi(argv[1]);
+
+  VectorWindow vec;
+  IndexedWindow idx(2 * w);
+  long long vec_ns = run(vec);
+  long long idx_ns = run(idx);
+
+  printf("[BENCH]window %d ops %d timeouts %ld/%ld vector ns/op %lld indexed ns/op %lld[/BENCH]\n",
+         w, OPS, vec.resent, idx.resent, vec_ns / OPS, idx_ns / OPS);
+  return 0;
+}
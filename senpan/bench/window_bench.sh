@@ -0,0 +1,15 @@
+#!/bin/bash
+
+#Title           :window_bench.sh
+#description     :Runs the SR sender window microbenchmark over growing
+#                 windows.  SendWindow with the timing wheel should stay
+#                 flat while the vector scans grow with the window.
+#Usage           :bench/window_bench.sh
+#====================================================================================
+
+cd "$(dirname "$0")/.."
+make -s bench_window || exit 1
+
+for WIN in 8 64 512 4096 32768 65536; do
+    ./bench_window $WIN
+done
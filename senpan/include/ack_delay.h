@@ -0,0 +1,39 @@
+#ifndef ACK_DELAY_H_
+#define ACK_DELAY_H_
+
+#include "simulator.h"
+
+/* T when --delack only gives N */
+#define DELACK_TIME 5.0
+
+/* Delayed ACKs of a receiver (--delack N,T).  ACKs of in-order packets */
+/* are held until N packets are waiting or T time units have passed     */
+/* since the first of them, then one cumulative ACK covers them all.    */
+/* The T limit is the entity's own timer.  With N = 0 nothing is ever   */
+/* held and the timer is never touched.                                 */
+class AckDelay
+{
+  public:
+    AckDelay(struct sim_context *_sim, int _AorB);
+
+    bool enabled() const { return packets > 0; }
+
+    /* one more packet to acknowledge: true if its ACK may wait, false */
+    /* if an ACK covering everything held must go out now              */
+    bool delay();
+    /* an ACK is going out anyway: nothing is held any more */
+    void flush();
+    /* the entity's timer went off: true if an ACK is held and must go */
+    /* out now                                                         */
+    bool expired();
+
+  private:
+    struct sim_context *sim;
+    int AorB;
+    int packets;       /* N */
+    float time;        /* T */
+    int held;
+    bool timer_running;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CHANNEL_H_
+#define CHANNEL_H_
+
+#include <deque>
+#include <vector>
+
+#include "random.h"
+
+/* what the link's queue does with a packet once it fills (--buffer) */
+#define BUFFER_TAIL_DROP 0
+#define BUFFER_RED       1
+
+/* names of the buffer policies, indexed by policy, NULL-terminated */
+extern const char *const buffer_policy_names[];
+
+/* The medium between A and B, as given on the command line */
+struct channel_params {
+  float bandwidth;           /* bytes per time unit, 0 for the original channel */
+  float delay;               /* propagation delay of the link */
+  int buffer;                /* packets the link holds at once, 0 for no bound */
+  int buffer_policy;         /* BUFFER_TAIL_DROP or BUFFER_RED */
+  float reorder;             /* share of packets held back to be overtaken */
+  float reorder_delay;       /* for up to this long */
+};
+
+/* RED's weight for the average queue and its drop probability at the */
+/* upper threshold; the thresholds are a quarter and three quarters of */
+/* the buffer                                                          */
+#define RED_WEIGHT 0.002
+#define RED_MAX_P  0.1
+/* how long a reordered packet is held back at most, by default */
+#define REORDER_DELAY 10.0
+/* most packets sent after a held one that may arrive before it; the */
+/* ones after those wait for it.  GBN and SR go round that many more */
+/* windows of sequence numbers with --reorder (see getseqspace()).   */
+#define REORDER_OVERTAKE 8
+
+/* Channel model of one run, one direction toward each entity.  The  */
+/* emulator hands every packet to send() and, unless it is lost,      */
+/* schedules its arrival for the time arrival() gives.               */
+class Channel
+{
+  public:
+    Channel(const struct channel_params &_params);
+    virtual ~Channel() {};
+
+    /* a packet of bytes bytes, header included, handed down toward to  */
+    /* at time now: when it has left the sender's link, or a negative   */
+    /* time if the link's queue drops it                                */
+    virtual float send(int to, int bytes, float now, SimRandom *rng) = 0;
+    /* when the packet that left at departed reaches to */
+    virtual float arrival(int to, float departed, SimRandom *rng) = 0;
+    /* the packet arrival() scheduled has reached to */
+    virtual void arrived(int /*to*/) {};
+    virtual const char *name() const = 0;
+
+    const struct channel_params params;
+    /* by direction, for the report */
+    int dropped[2];            /* by the full queue of the link */
+    int held[2];               /* held back to be overtaken */
+    int queue_peak[2];         /* most packets at the link at once */
+
+  protected:
+    /* extra time the next packet toward to is held back: 0, or for a  */
+    /* share reorder of packets uniform up to reorder_delay            */
+    float hold(int to, SimRandom *rng);
+    /* arrival of a packet that left at departed and is due at evtime,  */
+    /* held if it is held back itself: it may not overtake a held one   */
+    /* REORDER_OVERTAKE later ones have overtaken already, and comes    */
+    /* gap after that one instead, or right after it for no gap         */
+    float overtake(int to, float departed, float evtime, float gap, bool held);
+
+  private:
+    struct holding {
+      float evtime;            /* arrival of the held packet */
+      int overtaken;           /* by packets sent after it */
+    };
+    std::vector<struct holding> holding[2];
+};
+
+/* The original medium: a packet arrives 1 to 10 time units after the */
+/* latest one still on its way, so packets never overtake each other  */
+/* unless --reorder holds some back.  Size does not matter.           */
+class FifoChannel : public Channel
+{
+  public:
+    FifoChannel(const struct channel_params &_params);
+    float send(int /*to*/, int /*bytes*/, float now, SimRandom * /*rng*/) { return now; }
+    float arrival(int to, float departed, SimRandom *rng);
+    void arrived(int to) { pending[to]--; }
+    const char *name() const { return "fifo"; }
+
+  private:
+    /* packets on their way and arrival time of the last one scheduled */
+    int pending[2];
+    float tail[2];
+};
+
+/* A link of fixed bandwidth and propagation delay (--link): a packet */
+/* waits for the ones before it to leave, takes bytes / bandwidth to  */
+/* leave itself, then delay to arrive.  With --buffer the link holds  */
+/* at most that many packets, the one leaving included, and drops     */
+/* the next one at the tail, or early at random as RED does.          */
+class LinkChannel : public Channel
+{
+  public:
+    LinkChannel(const struct channel_params &_params);
+    float send(int to, int bytes, float now, SimRandom *rng);
+    float arrival(int to, float departed, SimRandom *rng);
+    const char *name() const { return "link"; }
+
+  private:
+    bool admit(int to, SimRandom *rng);
+
+    /* arrival time of the last packet not held back */
+    float tail[2];
+
+    /* times the packets at the link will have left it, oldest first */
+    std::deque<float> leaving[2];
+    double average[2];         /* RED's average queue */
+};
+
+/* the model the parameters call for */
+Channel *make_channel(const struct channel_params &params);
+
+#endif
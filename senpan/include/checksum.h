@@ -0,0 +1,67 @@
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "random.h"
+#include "simulator.h"
+
+/* Packet checksums (--checksum), one module for all protocols.  SUM8 */
+/* is the original one: the low bytes of seqnum and acknum plus every */
+/* payload byte, modulo 256.  INET is the ones' complement sum of     */
+/* 16-bit words of RFC 1071, CRC32C the Castagnoli CRC of iSCSI and   */
+/* SCTP.  Both of these also cover the length field.  Each covers the */
+/* payload in use, and never less than its first 20 bytes.           */
+#define CHECKSUM_SUM8   0
+#define CHECKSUM_INET   1
+#define CHECKSUM_CRC32C 2
+
+/* names of the checksums, indexed by kind, NULL-terminated */
+extern const char *const checksum_names[];
+
+/* checksum of kind over packet p */
+int paket_checksum(int kind, const struct pkt &p);
+
+/* the same by the run's --checksum */
+inline int checksum(struct sim_context *sim, const struct pkt &p)
+{
+  return paket_checksum(getchecksum(sim), p);
+}
+
+inline bool pass_checksum(struct sim_context *sim, const struct pkt &p)
+{
+  return p.checksum == checksum(sim, p);
+}
+
+/* A header damaged past what the checksum catches must not reach the */
+/* protocol's windows: seqnum and acknum must both lie in [first,     */
+/* max_seqnum), first being -1 where -1 stands for none.              */
+inline bool numbers_valid(const struct pkt &p, int first, int max_seqnum)
+{
+  return p.seqnum >= first && p.seqnum < max_seqnum && p.acknum >= first && p.acknum < max_seqnum;
+}
+
+/* most bits one corruption flips with --bitflip; a bare ACK has 128 */
+#define MAX_BITFLIPS 64
+
+/* flip bits distinct bits, drawn from rng's RNG_CORRUPT stream, among */
+/* the first bytes of p as the wire carries it: the header, checksum   */
+/* and length included, then the payload in use.  tolayer3() and the   */
+/* checksum benchmark corrupt packets with it alike.                   */
+void flip_bits(struct pkt &p, int bytes, int bits, SimRandom *rng);
+
+/* The algorithms on any buffer, for paket_checksum() and the benchmark */
+
+/* ones' complement checksum of len bytes, sum being the 16-bit word   */
+/* sum of anything before them (an even number of bytes)              */
+uint16_t inet_checksum(const void *data, size_t len, uint64_t sum);
+
+/* CRC32C of len bytes following those crc was computed over (0 for */
+/* none), as zlib's crc32() chains; crc32c() picks the SSE4.2        */
+/* instruction when the CPU has it and the table otherwise           */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+uint32_t crc32c_table(uint32_t crc, const void *data, size_t len);
+/* NULL where the build or the CPU has no SSE4.2 */
+extern uint32_t (*const crc32c_hardware)(uint32_t crc, const void *data, size_t len);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef EVENT_POOL_H_
+#define EVENT_POOL_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "event_queue.h"
+
+/* Slab allocator for struct event.  Events are carved out of slabs of */
+/* EVENT_SLAB_SIZE entries and recycled through a free list, so the    */
+/* steady state of a run does no heap allocation at all.               */
+#define EVENT_SLAB_SIZE 1024
+
+class EventPool
+{
+  public:
+    EventPool() : allocated(0), live(0), peak_live(0), free_list(NULL) {};
+    ~EventPool();
+
+    struct event *alloc();
+    void release(struct event *e);
+
+    unsigned long allocated;   /* events handed out over the run */
+    unsigned long live;        /* events currently handed out */
+    unsigned long peak_live;   /* high-water mark of live */
+    size_t slab_count() const { return slabs.size(); }
+    size_t slab_bytes() const { return slabs.size() * EVENT_SLAB_SIZE * sizeof(struct event); }
+
+  private:
+    struct event *free_list;
+    std::vector<struct event *> slabs;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef EVENT_QUEUE_H_
+#define EVENT_QUEUE_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "simulator.h"
+
+/* an "event" is one pending timer interrupt, layer 5 arrival or layer 3  */
+/* delivery.  evseq is stamped by the queue on insertion and only used to */
+/* break ties on evtime, so that every engine pops events in exactly the  */
+/* order the original sorted linked list did.                             */
+struct event {
+   float evtime;           /* event time */
+   int evtype;             /* event type code */
+   int eventity;           /* entity where event occurs */
+   struct event *prev;
+   struct event *next;
+   unsigned long evseq;    /* insertion order, for tie-breaking */
+   size_t qindex;          /* slot in the heap (heap engine only) */
+   long long qday;         /* calendar day (calendar engine only) */
+   /* packet (if any) assoc w/ this event, inline; last, so the fields */
+   /* the queues look at share a cache line whatever PKT_MAX_PAYLOAD is */
+   struct pkt evpkt;
+ };
+
+/* true if a must be simulated before b.  The list engine inserted a new */
+/* event in front of any event with the same time, so on a tie the more */
+/* recently inserted event goes first.                                   */
+inline bool event_before(const struct event *a, const struct event *b)
+{
+  if (a->evtime != b->evtime)
+    return a->evtime < b->evtime;
+  return a->evseq > b->evseq;
+}
+
+typedef void (*event_visitor)(struct event *e, void *arg);
+
+/* Pending event set used by the simulator main loop */
+class EventQueue
+{
+  public:
+    EventQueue() : next_seq(0) {};
+    virtual ~EventQueue() {};
+
+    void insert(struct event *e)
+    {
+      e->evseq = next_seq++;
+      push(e);
+    }
+
+    /* remove and return the earliest event, NULL if the queue is empty */
+    virtual struct event *pop() = 0;
+    /* unlink an event that is still pending */
+    virtual void remove(struct event *e) = 0;
+    virtual size_t size() const = 0;
+    /* call fn on every pending event, in no particular order */
+    virtual void visit(event_visitor fn, void *arg) = 0;
+    virtual const char *name() const = 0;
+
+  protected:
+    virtual void push(struct event *e) = 0;
+
+  private:
+    unsigned long next_seq;
+};
+
+/* The original Kurose event list: sorted doubly-linked list, O(n) insert */
+class ListEventQueue : public EventQueue
+{
+  public:
+    ListEventQueue() : head(NULL), count(0) {};
+    struct event *pop();
+    void remove(struct event *e);
+    size_t size() const { return count; }
+    void visit(event_visitor fn, void *arg);
+    const char *name() const { return "list"; }
+
+  protected:
+    void push(struct event *e);
+
+  private:
+    struct event *head;
+    size_t count;
+};
+
+/* d-ary min-heap, O(log n) insert/pop/remove */
+class HeapEventQueue : public EventQueue
+{
+  public:
+    HeapEventQueue(int _arity) : arity(_arity) {};
+    struct event *pop();
+    void remove(struct event *e);
+    size_t size() const { return heap.size(); }
+    void visit(event_visitor fn, void *arg);
+    const char *name() const { return "heap"; }
+
+  protected:
+    void push(struct event *e);
+
+  private:
+    size_t arity;
+    std::vector<struct event *> heap;
+    void place(size_t i, struct event *e);
+    void sift_up(size_t i);
+    void sift_down(size_t i);
+};
+
+/* Brown's calendar queue, O(1) expected insert/pop for large event sets */
+class CalendarEventQueue : public EventQueue
+{
+  public:
+    CalendarEventQueue();
+    struct event *pop();
+    void remove(struct event *e);
+    size_t size() const { return count; }
+    void visit(event_visitor fn, void *arg);
+    const char *name() const { return "calendar"; }
+
+  protected:
+    void push(struct event *e);
+
+  private:
+    std::vector<struct event *> buckets; /* sorted list per day of the year */
+    double width;                        /* length of one day */
+    long long cur_day;                   /* day currently being drained */
+    float last_time;                     /* time of the last popped event */
+    size_t count;
+    long long day_of(float t) const;
+    void link(struct event *e);
+    void unlink(struct event *e);
+    void resize(size_t nbuckets);
+};
+
+/* "list", "calendar", "heap" (4-ary) or "heapN" for an N-ary heap; */
+/* returns NULL for an unknown engine name */
+EventQueue *make_event_queue(const char *name);
+
+#endif
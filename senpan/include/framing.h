@@ -0,0 +1,22 @@
+#ifndef FRAMING_H_
+#define FRAMING_H_
+
+#include "simulator.h"
+
+/* bytes of the length in front of each message of a framed payload */
+#define FRAME_HEADER 2
+
+/* Payload formats.  Without an MTU (getmtu() is 0) a data packet       */
+/* carries one 20-byte message as it is, the original format.  With    */
+/* one, its payload is a run of messages, each behind its length in     */
+/* FRAME_HEADER bytes, least significant first, and pkt.length covers   */
+/* them all.  A message is never split over packets.                    */
+
+/* make room for a message of length bytes at the end of the framed   */
+/* payload of p: where its bytes go, or NULL if it does not fit in mtu */
+char *frame_message(struct pkt &p, int length, int mtu);
+
+/* hand the messages of data packet p to layer 5 of AorB, oldest first */
+void deliver_paket(struct sim_context *sim, int AorB, const struct pkt &p);
+
+#endif
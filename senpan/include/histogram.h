@@ -0,0 +1,42 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdint.h>
+#include <vector>
+
+/* Log-linear histogram of non-negative values, in the style of HdrHistogram. */
+/* Values are counted in multiples of unit; below 2^HIST_SUB_BITS units each  */
+/* one has its own bucket, above that every power of two is split into        */
+/* 2^(HIST_SUB_BITS-1) buckets, so a percentile is within 1/64 of the value   */
+/* it reports whatever the range.  Recording is O(1) and memory grows with    */
+/* the log of the largest value, never with the number of samples.            */
+#define HIST_SUB_BITS 7
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_HALF     (HIST_SUB / 2)
+
+class Histogram
+{
+  public:
+    Histogram(double _unit = 0.01) : unit(_unit), total(0), sum(0), max_value(0) {};
+
+    void record(double value);
+
+    uint64_t count() const { return total; }
+    double mean() const { return total ? sum / total : 0; }
+    double max() const { return max_value; }
+    /* smallest value at or above p percent of the samples (0 < p <= 100), */
+    /* as the top of its bucket but never beyond max(); 0 when empty       */
+    double percentile(double p) const;
+
+  private:
+    std::vector<uint64_t> counts;
+    double unit;
+    uint64_t total;
+    double sum;
+    double max_value;
+
+    static int bucket(uint64_t units);
+    static uint64_t bucket_top(int b);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef PROTOCOLS_H_
+#define PROTOCOLS_H_
+
+#include "simulator.h"
+
+/* The protocols built into the simulator.  Each one lives in its own */
+/* namespace, so their Sender/Reciver classes and helpers can all be  */
+/* linked into one binary.                                            */
+namespace abt {
+Protocol *create(struct sim_context *sim);
+}
+
+namespace gbn {
+Protocol *create(struct sim_context *sim);
+}
+
+namespace sr {
+Protocol *create(struct sim_context *sim);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stdint.h>
+
+/* Independent random streams used by the network emulator.  With a    */
+/* per-stream generator, changing e.g. the loss rate does not shift the */
+/* arrival times or channel delays of a seeded run.                     */
+enum rng_stream {
+  RNG_ARRIVAL,   /* layer 5 inter-arrival times */
+  RNG_LOSS,      /* packet loss */
+  RNG_CORRUPT,   /* packet corruption */
+  RNG_DELAY,     /* channel delay */
+  RNG_SIZE,      /* message lengths (--msgsize) */
+  RNG_CHANNEL,   /* link queue drops and reordering (--buffer, --reorder) */
+  RNG_STREAMS
+};
+
+/* Simulator-owned random number generator, one per simulation run */
+class SimRandom
+{
+  public:
+    virtual ~SimRandom() {};
+    /* uniform float in [0,1] drawn from the given stream */
+    virtual float uniform(int stream) = 0;
+    virtual const char *name() const = 0;
+};
+
+/* Bit-exact re-implementation of glibc's rand() (TYPE_3 additive    */
+/* feedback generator).  All streams share the one sequence, in the  */
+/* order the original emulator consumed it, so traces and grader     */
+/* baselines produced with rand() still match.                       */
+class RandCompatRandom : public SimRandom
+{
+  public:
+    RandCompatRandom(unsigned int seed);
+    float uniform(int stream);
+    const char *name() const { return "rand"; }
+
+  private:
+    int32_t r[34];
+    int pos;
+    int32_t next();
+};
+
+/* xoshiro256** with one state per stream; the streams are spaced */
+/* 2^128 draws apart with the generator's jump function           */
+class XoshiroRandom : public SimRandom
+{
+  public:
+    XoshiroRandom(unsigned int seed);
+    float uniform(int stream);
+    const char *name() const { return "xoshiro"; }
+
+  private:
+    uint64_t s[RNG_STREAMS][4];
+    static uint64_t next(uint64_t *st);
+    static void jump(uint64_t *st);
+};
+
+/* "rand" or "xoshiro"; returns NULL for an unknown generator name */
+SimRandom *make_random(const char *name, unsigned int seed);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef RECV_WINDOW_H_
+#define RECV_WINDOW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "simulator.h"
+
+/* Receiver window of selective repeat.  The window_size sequence     */
+/* numbers from the base on live in a circular buffer, seqnum modulo  */
+/* window_size, with one presence bit per slot.  Buffering a packet   */
+/* and taking the base are O(1) and never allocate; ready() finds the */
+/* run of in-order packets with count-trailing-zeros, 64 at a time.   */
+class RecvWindow
+{
+  public:
+    /* max_seqnum must be a multiple of window_size */
+    RecvWindow(int window_size, int max_seqnum);
+
+    bool empty() const { return count == 0; }
+    /* next sequence number expected in order */
+    int base() const { return base_num; }
+    /* seqnum falls within the window */
+    bool in_window(int seqnum) const;
+    /* seqnum is buffered */
+    bool contains(int seqnum) const;
+
+    struct pkt &packet(int seqnum) { return slots[seqnum % size]; }
+    const struct pkt &packet(int seqnum) const { return slots[seqnum % size]; }
+
+    /* buffer p, which must be in the window and not yet buffered */
+    void add(const struct pkt &p);
+    /* number of packets buffered in order from the base */
+    int ready() const;
+    /* selective ACK: bit i of bits (LSB first) is set if base + 1 + i is */
+    /* buffered; nbits bits are written, those past the window are clear */
+    void sack(char *bits, int nbits) const;
+    /* drop the base packet and move the window up by one */
+    void pop();
+
+  private:
+    std::vector<struct pkt> slots;
+    std::vector<uint64_t> present;   /* one bit per slot */
+    int size;
+    int max_seqnum;
+    int base_num;
+    int count;
+
+    bool test(int slot) const { return (present[slot >> 6] >> (slot & 63)) & 1; }
+};
+
+#endif
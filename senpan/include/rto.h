@@ -0,0 +1,39 @@
+#ifndef RTO_H_
+#define RTO_H_
+
+#include "simulator.h"
+
+/* Retransmission timeout of a sender (RFC 6298).  In RTO_FIXED mode the */
+/* timeout stays at its initial value.  In RTO_ADAPTIVE mode it follows  */
+/* Jacobson/Karels: SRTT and RTTVAR are smoothed from RTT samples and    */
+/* RTO = SRTT + 4 * RTTVAR, doubled on every timeout until an ACK for    */
+/* new data arrives (as BSD does).  Callers apply Karn's rule: never     */
+/* sample a packet that was resent.                                      */
+#define RTO_INITIAL 20.0
+#define RTO_MIN     1.0
+#define RTO_MAX     1000.0
+
+class RtoEstimator
+{
+  public:
+    RtoEstimator(int _mode) : mode(_mode), srtt(0), rttvar(0), rto(RTO_INITIAL), shift(0) {};
+
+    /* current timeout interval */
+    float timeout() const;
+
+    /* a packet sent once was ACKed rtt time units after it was sent */
+    void sample(float rtt);
+    /* an ACK acknowledged new data: drop the backoff */
+    void acked() { shift = 0; }
+    /* a timer went off */
+    void backoff();
+
+  private:
+    int mode;
+    float srtt;     /* 0 until the first sample */
+    float rttvar;
+    float rto;      /* before backoff */
+    int shift;      /* number of doublings */
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SEND_QUEUE_H_
+#define SEND_QUEUE_H_
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "simulator.h"
+
+/* Messages from layer 5 waiting for room in a sender's window          */
+/* (--queue N,POLICY).  Unbounded by default.  Once N are waiting, a    */
+/* new message is dropped (QUEUE_DROP_NEWEST), pushes out the oldest   */
+/* waiting one (QUEUE_DROP_OLDEST), or stops the arrivals at the       */
+/* entity until the queue has room again (QUEUE_BLOCK).  Messages are  */
+/* queued without a sequence number, the sender numbers them as it     */
+/* takes them, so a drop leaves no gap.  Depth, bytes and the time     */
+/* each message waited are reported to the simulator.  Only the bytes  */
+/* of each message are kept, not a whole struct msg.                   */
+class SendQueue
+{
+  public:
+    SendQueue(struct sim_context *_sim, int _AorB);
+
+    bool empty() const { return entries.empty(); }
+    size_t size() const { return entries.size(); }
+
+    /* a message from layer 5: false if it was dropped */
+    bool push(const struct msg &message);
+    /* take the oldest message, or as many as fit the run's MTU, off  */
+    /* the queue into the payload of p and set p.length (framing.h);   */
+    /* the queue must not be empty                                     */
+    void pack(struct pkt &p);
+
+  private:
+    struct entry {
+      int length;
+      float queued_time;
+    };
+
+    void pop();        /* the oldest message is sent: count its wait */
+    void discard();    /* the oldest message leaves the buffer */
+
+    struct sim_context *sim;
+    int AorB;
+    int limit;           /* 0 for none */
+    int policy;
+    bool blocked;
+    int mtu;
+    std::deque<struct entry> entries;
+    /* bytes of every entry from head on, oldest first; the space before */
+    /* head is given back once it is most of the buffer                   */
+    std::vector<char> data;
+    size_t head;
+};
+
+#endif
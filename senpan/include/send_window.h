@@ -0,0 +1,46 @@
+#ifndef SEND_WINDOW_H_
+#define SEND_WINDOW_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "simulator.h"
+
+/* Sender window of selective repeat.  Every unACKed packet has a slot */
+/* indexed by its sequence number, threaded on an intrusive list in    */
+/* send order whose head is the window base.  Adding, ACKing and       */
+/* looking up a packet are all O(1), whatever the window size.  The    */
+/* packets' timers live in a TimingWheel under the same numbers.       */
+class SendWindow
+{
+  public:
+    SendWindow(int max_seqnum);
+
+    bool empty() const { return head == -1; }
+    bool contains(int seqnum) const;
+    /* oldest unACKed sequence number, -1 if empty */
+    int base() const { return head; }
+    /* the one sent after seqnum, -1 at the end */
+    int next(int seqnum) const { return slots[seqnum].next; }
+
+    const struct pkt &packet(int seqnum) const { return slots[seqnum].packet; }
+
+    /* p was sent */
+    void add(const struct pkt &p);
+    /* drop seqnum from the window, false if it was not in it */
+    bool ack(int seqnum);
+
+  private:
+    struct slot {
+      struct pkt packet;
+      bool unacked;
+      int prev;
+      int next;
+    };
+
+    std::vector<struct slot> slots;
+    int head;
+    int tail;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SHARED_TIMER_H_
+#define SHARED_TIMER_H_
+
+#include <vector>
+#include "simulator.h"
+
+/* slots of an entity's timer in bidirectional transfer */
+#define SLOT_SENDER 0      /* the sender's retransmissions */
+#define SLOT_ACK    1      /* an ACK the receiver holds for data to ride on */
+
+/* An entity's one timer, shared by several deadlines.  Each slot starts */
+/* and stops like the timer itself, a running slot keeping its deadline, */
+/* and the timer is kept aimed at the earliest deadline.  With a single  */
+/* slot every call goes straight to starttimer() and stoptimer().        */
+class SharedTimer
+{
+  public:
+    SharedTimer(struct sim_context *_sim, int _AorB, int slots);
+
+    void start(int slot, float increment);
+    void stop(int slot);
+    bool running(int slot) const { return deadlines[slot] >= 0; }
+    /* the timer went off: the slots due by now stop and come back as a */
+    /* bit mask, and the timer is aimed at the others                   */
+    unsigned expire();
+
+  private:
+    struct sim_context *sim;
+    int AorB;
+    std::vector<float> deadlines;   /* -1 while a slot is stopped */
+    float aimed;                    /* what the timer is set for, -1 if off */
+
+    void aim();
+};
+
+#endif
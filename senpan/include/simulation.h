@@ -0,0 +1,167 @@
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include <vector>
+
+#include "event_queue.h"
+#include "event_pool.h"
+#include "channel.h"
+#include "histogram.h"
+#include "random.h"
+#include "trace.h"
+#include "simulator.h"
+
+/* lengths of loss bursts the report counts one by one, longer ones together */
+#define BURST_LENGTHS 8
+
+/* Parameters of one simulation run, as given on the command line */
+struct sim_params {
+  int seed;
+  int win_size;
+  int nsimmax;               /* number of msgs to generate, then stop */
+  float lossprob;            /* probability that a packet is dropped  */
+  float corruptprob;         /* probability that one bit is packet is flipped */
+  float lambda;              /* arrival rate of messages from layer 5 */
+  int trace;
+  const char *engine;        /* event queue engine, see make_event_queue() */
+  const char *generator;     /* random generator, see make_random() */
+  const char *protocol;      /* one of protocol_names */
+  int rto_mode;              /* RTO_FIXED or RTO_ADAPTIVE */
+  int dupacks;               /* fast retransmit threshold, 0 for none */
+  int ack_mode;              /* ACK_EACH or ACK_SACK */
+  int delack_packets;        /* delayed ACKs: at most this many held, 0 for none */
+  float delack_time;         /* and for at most this long */
+  int channels;              /* alternating-bit channels of ABT */
+  int queue_limit;           /* sender queue bound, 0 for none */
+  int queue_policy;          /* QUEUE_DROP_NEWEST, QUEUE_DROP_OLDEST or QUEUE_BLOCK */
+  int bidirectional;         /* B sends messages to A too */
+  float piggyback_time;      /* longest an ACK waits for data to ride on */
+  int msg_min, msg_max;      /* message lengths, 20 and 20 by default */
+  int mtu;                   /* packet payload limit, 0 for the original format */
+  int checksum;              /* CHECKSUM_SUM8, CHECKSUM_INET or CHECKSUM_CRC32C */
+  struct channel_params channel;  /* the medium, see make_channel() */
+  float gilbert_burst;       /* packets the bad state lasts on average, 0 for independent losses */
+  float gilbert_bad_loss;    /* loss probability in the bad state */
+  float gilbert_good_loss;   /* and in the good one */
+  int bitflips;              /* random bits a corruption flips, 0 for the emulator's */
+  int report;                /* every block of the report, not only the options' */
+};
+
+/* names of the RTO and ACK modes, indexed by mode, NULL-terminated */
+extern const char *const rto_mode_names[];
+extern const char *const ack_mode_names[];
+extern const char *const queue_policy_names[];
+
+/* msg_track: one message handed to layer 4 but not yet delivered to layer 5 */
+struct msg_track {
+  char msg_chars[20];        /* the message's letter; its bytes repeat these */
+  int length;
+  float sent_time;           /* when layer 5 handed it down */
+  bool dropped;              /* dropped by the sender's queue, never delivered */
+};
+
+/* Everything one run of the network emulator owns.  The simulator API  */
+/* takes the run as its first argument, so any number of runs can share */
+/* a process and run concurrently on different threads.                 */
+struct sim_context {
+  /* Statistics */
+  int A_application;
+  int A_transport;
+  int B_application;
+  int B_transport;
+  int A_retransmit;          /* packets resent by A */
+  /* the same from B to A, in bidirectional transfer */
+  int B_application_out;
+  int A_application_in;
+  int B_retransmit;
+  /* ACKs sent by A and B: in packets of their own and piggybacked on data */
+  int acks_alone[2];
+  int acks_piggybacked[2];
+  /* bytes by entity: of messages handed down and delivered at layer 5, */
+  /* and of every packet sent into layer 3, headers included            */
+  long app_bytes_out[2];
+  long app_bytes_in[2];
+  long wire_bytes[2];
+  /* packets layer 4 filled from its queue, and the messages they took */
+  int packets_packed[2];
+  int messages_packed[2];
+
+  /* sender queues of A and B */
+  int queue_peak[2];         /* most messages waiting at once */
+  long queue_peak_bytes[2];  /* and the most bytes they took */
+  int queue_dropped[2];      /* messages given up */
+  int arrivals_held[2];      /* times arrivals were held for a full queue */
+  Histogram queue_delay[2];  /* time each message waited */
+  int arrivals_blocked[2];
+  struct event *heldarrival; /* arrival waiting for a queue to drain */
+
+  int win_size;
+
+  int TRACE;                 /* for my debugging */
+  int nsim;                  /* number of messages from 5 to 4 so far */
+  int nsimmax;               /* number of msgs to generate, then stop */
+  float time_local;
+  float lossprob;            /* probability that a packet is dropped  */
+  float corruptprob;         /* probability that one bit is packet is flipped */
+  float lambda;              /* arrival rate of messages from layer 5 */
+  int   ntolayer3;           /* number sent into layer 3 */
+  int   nlost;               /* number lost in media */
+  int ncorrupt;              /* number corrupted by media*/
+  int nundetected;           /* and corrupted with their checksum still right */
+  int nmisdelivered;         /* messages delivered wrong, with --bitflip */
+
+  /* Gilbert-Elliott losses (--gilbert): the chance per packet of going */
+  /* from the good state to the bad one and back, the loss probability  */
+  /* in each, and the state of the channel from A and from B            */
+  float gilbert_enter, gilbert_leave;
+  float gilbert_bad_loss, gilbert_good_loss;
+  bool gilbert_bad[2];
+  int bitflips;              /* random bits a corruption flips, 0 for the emulator's */
+  /* runs of packets lost in a row, by sender: the current one, and */
+  /* how many ended at each length                                  */
+  int loss_run[2];
+  std::vector<int> loss_bursts[2];
+
+  SimRandom *simrandom;      /* generator for this run */
+  EventQueue *evqueue;       /* the event list */
+  EventPool evpool;          /* storage for every event, recycled */
+  struct event *timerevent[2];  /* pending timer of A and B */
+
+  Channel *channel;          /* the medium toward A and B */
+
+  /* rings of the messages handed to layer 4 but not yet delivered to     */
+  /* layer 5, oldest first, one for each sending entity.  Their size      */
+  /* follows the number of messages in flight, never the length of the run. */
+  std::vector<struct msg_track> application_msgs[2];  /* size is a power of 2 */
+  int msg_head[2];           /* slot of the oldest undelivered message */
+  int msg_inflight[2], msg_peak[2];
+  long cur_msg_sent, cur_msg_recv;
+  Histogram latency[2];      /* layer 5 to layer 5 time of each message, by sender */
+
+  const char *protocol;      /* name of the protocol under test */
+  int rto_mode;              /* RTO_FIXED or RTO_ADAPTIVE */
+  int dupacks;               /* fast retransmit threshold, 0 for none */
+  int ack_mode;              /* ACK_EACH or ACK_SACK */
+  int delack_packets;        /* delayed ACKs: at most this many held, 0 for none */
+  float delack_time;         /* and for at most this long */
+  int channels;              /* alternating-bit channels of ABT */
+  int queue_limit;           /* sender queue bound, 0 for none */
+  int queue_policy;          /* QUEUE_DROP_NEWEST, QUEUE_DROP_OLDEST or QUEUE_BLOCK */
+  int bidirectional;         /* B sends messages to A too */
+  float piggyback_time;      /* longest an ACK waits for data to ride on */
+  int msg_min, msg_max;      /* message lengths */
+  int mtu;                   /* packet payload limit, 0 for the original format */
+  int checksum;              /* CHECKSUM_SUM8, CHECKSUM_INET or CHECKSUM_CRC32C */
+  int report;                /* every block of the report, not only the options' */
+  Protocol *proto;           /* protocol entities A and B of this run */
+  TraceRing *tracering;      /* binary trace sink, NULL for text on stdout */
+
+  /* engine, generator and protocol names must be valid */
+  sim_context(const struct sim_params &p);
+  ~sim_context();
+};
+
+/* run one simulation to completion on the calling thread */
+void run_simulation(struct sim_context *ctx);
+
+#endif
@@ -1,41 +1,151 @@
 #ifndef SIMULATOR_H_
 #define SIMULATOR_H_
 
-#define BIDIRECTIONAL 0
+/* Largest message and packet payload in bytes, fixed at build time.  */
+/* Runs without --msgsize or --mtu only ever use the first 20, and    */
+/* every msg, pkt and event has room for this many, so only builds    */
+/* for the framed format raise it.                                    */
+#ifndef PKT_MAX_PAYLOAD
+#define PKT_MAX_PAYLOAD 20
+#endif
+#if PKT_MAX_PAYLOAD < 20
+#error "PKT_MAX_PAYLOAD must be at least 20"
+#endif
 
 /* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
 /* 4 (students' code).  It contains the data (characters) to be delivered */
 /* to layer 5 via the students transport level protocol entities.         */
+/* length is 20 unless the run has --msgsize.                            */
 struct msg {
-  char data[20];
+  char data[PKT_MAX_PAYLOAD];
+  int length;
 };
 
 /* a packet is the data unit passed from layer 4 (students code) to layer */
 /* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
+/* students must follow.  length counts the payload bytes in use: 20 for */
+/* a data packet of the original format, 0 for a bare ACK.               */
 struct pkt {
    int seqnum;
    int acknum;
    int checksum;
-   char payload[20];
+   int length;
+   char payload[PKT_MAX_PAYLOAD];
 };
 
-/* Implementation framework interface */
-void A_output(struct msg message);
-void B_output(struct msg message);
-void A_input(struct pkt packet);
-void A_timerinterrupt();
-void A_init();
-
-void B_input(struct pkt packet);
-void B_init();
-
-/* Simulator API */
-void starttimer(int AorB, float increment);
-void stoptimer(int AorB);
-void tolayer3(int AorB, struct pkt packet);
-void tolayer5(int AorB, char datasent[]);
-int getwinsize();
-float get_sim_time();
+/* bytes a packet takes on the wire besides its payload */
+#define PKT_HEADER 16
+
+struct sim_context;
+
+/* Implementation framework interface.  Each protocol implements the */
+/* entity routines in a subclass; one instance serves one run.       */
+class Protocol
+{
+  public:
+    Protocol(struct sim_context *_sim) : sim(_sim) {};
+    virtual ~Protocol() {};
+
+    virtual void A_output(const struct msg &message) = 0;
+    virtual void A_input(const struct pkt &packet) = 0;
+    virtual void A_timerinterrupt() = 0;
+    virtual void A_init() = 0;
+
+    /* only called for bidirectional transfer (--bidirectional) */
+    virtual void B_output(const struct msg & /*message*/) {};
+    virtual void B_timerinterrupt() {};
+    virtual void B_input(const struct pkt &packet) = 0;
+    virtual void B_init() = 0;
+
+  protected:
+    struct sim_context *sim;   /* the run this instance belongs to */
+};
+
+/* Defined by the protocol set linked into the binary: the names it */
+/* offers, NULL-terminated, and a new instance of one of them for a */
+/* run (NULL for an unknown name).                                  */
+extern const char *const protocol_names[];
+Protocol *make_protocol(const char *name, struct sim_context *sim);
+
+/* Simulator API: every call names the run it acts on */
+void starttimer(struct sim_context *sim, int AorB, float increment);
+void stoptimer(struct sim_context *sim, int AorB);
+void tolayer3(struct sim_context *sim, int AorB, const struct pkt &packet);
+void tolayer5(struct sim_context *sim, int AorB, char datasent[]);
+/* the same for a message of any length (--msgsize) */
+void tolayer5msg(struct sim_context *sim, int AorB, const struct msg &message);
+int getwinsize(struct sim_context *sim);
+/* sequence numbers GBN and SR go round: 2 windows, or with --reorder  */
+/* enough more that a held packet can not come back as a new one      */
+int getseqspace(struct sim_context *sim);
+float get_sim_time(struct sim_context *sim);
+int gettrace(struct sim_context *sim);
+
+/* retransmission timeout policy of the run (--rto) */
+#define RTO_FIXED    0
+#define RTO_ADAPTIVE 1
+int getrtomode(struct sim_context *sim);
+/* what B's ACKs carry (--ack): the packet ACKed, or for SR also the  */
+/* receive base and a bitmap of the packets buffered beyond it        */
+#define ACK_EACH 0
+#define ACK_SACK 1
+int getackmode(struct sim_context *sim);
+/* delayed ACKs (--delack N,T): hold ACKs for up to N packets or T time */
+/* units; N is 0 when ACKs are not delayed                              */
+int getdelackpackets(struct sim_context *sim);
+float getdelacktime(struct sim_context *sim);
+/* duplicate ACKs that trigger a fast retransmit (--dupacks), 0 for none */
+int getdupacks(struct sim_context *sim);
+/* alternating-bit channels ABT runs side by side (--channels), 1 by default */
+int getchannels(struct sim_context *sim);
+/* bound on the messages a sender keeps waiting for its window (--queue */
+/* N,POLICY): what happens to the next one once N are waiting; N is 0  */
+/* when the queue is unbounded                                         */
+#define QUEUE_DROP_NEWEST 0
+#define QUEUE_DROP_OLDEST 1
+#define QUEUE_BLOCK       2
+int getqueuelimit(struct sim_context *sim);
+int getqueuepolicy(struct sim_context *sim);
+/* layer 4 of AorB has given up a message from layer 5 for good: the  */
+/* one handed down age messages before the latest (0 for the latest)  */
+void dropmsg(struct sim_context *sim, int AorB, int age);
+/* hold (on) or release (off) the arrivals from layer 5 at AorB */
+void blockarrivals(struct sim_context *sim, int AorB, int on);
+/* AorB now has depth messages, taking bytes, waiting for its window */
+void countqueued(struct sim_context *sim, int AorB, int depth, long bytes);
+/* AorB has taken a message off its queue after it waited delay */
+void countqueuedelay(struct sim_context *sim, int AorB, float delay);
+/* AorB has just resent count packets, for the report */
+void countretransmit(struct sim_context *sim, int AorB, int count);
+/* B sends messages to A as well (--bidirectional), 0 for A to B only */
+int getbidirectional(struct sim_context *sim);
+/* then how long a receiver holds an ACK for data going back to carry it */
+/* (--piggyback T); 0 sends it at once unless data leaves right then     */
+#define PIGGYBACK_TIME 5.0
+float getpiggybacktime(struct sim_context *sim);
+/* AorB has acknowledged data, in an ACK packet of its own or piggybacked */
+/* on a data packet it sent anyway                                      */
+void countack(struct sim_context *sim, int AorB, int piggybacked);
+/* most bytes a packet's payload may carry (--mtu): senders fill it with */
+/* as many whole messages as fit, each framed by its length (see        */
+/* framing.h).  0 when every packet carries one message of 20 bytes as  */
+/* it is, the original format.                                          */
+int getmtu(struct sim_context *sim);
+/* AorB has filled a packet with messages messages from its queue */
+void countpacked(struct sim_context *sim, int AorB, int messages);
+/* the checksum the protocols put on their packets (--checksum), see */
+/* checksum.h                                                        */
+int getchecksum(struct sim_context *sim);
+
+/* Trace output of a level above TRACE_MAX_LEVEL is compiled out; */
+/* build with TRACE_MAX_LEVEL=0 to strip every trace point.       */
+#ifndef TRACE_MAX_LEVEL
+#define TRACE_MAX_LEVEL 3
+#endif
+
+#define TRACING(sim, level) ((level) <= TRACE_MAX_LEVEL && gettrace(sim) >= (level))
+
+/* protocol debug output, printed from trace level 3 (-v 3) */
+#define DEBUG_PRINTF(...) do { if (TRACING(sim, 3)) printf(__VA_ARGS__); } while (0)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef TIMING_WHEEL_H_
+#define TIMING_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* Hierarchical timing wheel for many software timers multiplexed onto  */
+/* one physical timer.  Timers are named by small integer ids (e.g. a  */
+/* sequence number) and may have any length.  Arm and cancel are O(1); */
+/* advance() hands back every timer that is due in one batch, and      */
+/* next_expiry() tells when to set the physical timer for.             */
+/*                                                                     */
+/* Each of the WHEEL_LEVELS wheels has WHEEL_SLOTS slots; a slot of     */
+/* level l spans WHEEL_SLOTS^l ticks.  A timer sits in the lowest level */
+/* whose slots can tell its tick apart from the current one, and is    */
+/* moved down a level when the wheel reaches its slot.  Timers beyond  */
+/* the top wheel wait on an overflow list.  Deadlines are kept exactly, */
+/* ticks only decide where a timer is stored.                          */
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+class TimingWheel
+{
+  public:
+    /* ids run from 0 to capacity-1 */
+    TimingWheel(int capacity, double tick);
+
+    size_t size() const { return count; }
+    bool armed(int id) const { return timers[id].slot != -1; }
+    double deadline(int id) const { return timers[id].deadline; }
+
+    /* (re)arm timer id to expire at deadline */
+    void arm(int id, double deadline);
+    void cancel(int id);
+
+    /* move the wheel to now and append the ids of every timer due by */
+    /* then (deadline <= now) to expired, earliest tick first; those  */
+    /* timers are disarmed                                            */
+    void advance(double now, std::vector<int> &expired);
+    /* the same when the physical timer set for deadline goes off at   */
+    /* now; float rounding of the event time must not leave the timers */
+    /* it was set for unexpired, so the wheel moves at least that far  */
+    void expire(double now, double deadline, std::vector<int> &expired);
+
+    /* earliest deadline of any armed timer, -1 if none is */
+    double next_expiry() const;
+
+  private:
+    struct timer {
+      double deadline;
+      long long expires;   /* tick of the deadline */
+      int slot;            /* level * WHEEL_SLOTS + slot, -1 if idle */
+      int prev;
+      int next;
+    };
+
+    std::vector<struct timer> timers;
+    int slots[WHEEL_LEVELS * WHEEL_SLOTS + 1];   /* list head per slot, then overflow */
+    uint64_t occupied[WHEEL_LEVELS];         /* non-empty slots */
+    double tick;
+    long long cur;                           /* current tick */
+    size_t count;
+
+    void place(int id);
+    void unlink(int id);
+    void cascade(int level);
+    double earliest(int slot) const;
+};
+
+#endif
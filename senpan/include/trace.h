@@ -0,0 +1,95 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "simulator.h"
+
+/* Emulator trace points.  Each one is a fixed-size record, so a run can */
+/* log into a memory-mapped ring instead of formatting text; the text is */
+/* rendered from the same records either way (see trace_print()).        */
+enum trace_kind {
+  TR_EVENT,        /* event taken off the event list, level 2 */
+  TR_MAINLOOP,     /* message handed to A_output, level 3 */
+  TR_INSERT,       /* event scheduled, level 3 */
+  TR_ARRIVAL,      /* next layer 5 arrival generated, level 3 */
+  TR_STOPTIMER,    /* level 3 */
+  TR_STARTTIMER,   /* level 3 */
+  TR_LOST,         /* packet dropped by the channel, level 1 */
+  TR_TOLAYER3,     /* packet handed to the channel, level 3 */
+  TR_CORRUPT,      /* packet corrupted by the channel, level 1 */
+  TR_SCHEDULE,     /* packet arrival scheduled, level 3 */
+  TR_TOLAYER5,     /* data delivered to layer 5, level 3 */
+  TR_DROPPED,      /* packet dropped by the queue of a link, level 1 */
+  TR_KINDS
+};
+
+/* what a record keeps of a packet: its header and the first 20 bytes */
+/* of the payload, whatever PKT_MAX_PAYLOAD the emulator was built with */
+struct trace_packet {
+  int seqnum;
+  int acknum;
+  int checksum;
+  char payload[20];
+};
+
+struct trace_record {
+  float time;            /* simulation time when recorded */
+  float evtime;          /* time of the event concerned, if any */
+  uint8_t kind;          /* enum trace_kind */
+  uint8_t entity;
+  uint8_t evtype;
+  uint8_t unused;
+  struct trace_packet packet;  /* packet, or message data in packet.payload */
+};
+
+/* render one record exactly as the emulator's text trace */
+void trace_print(FILE *out, const struct trace_record &r);
+
+/* Records in a trace file, a power of 2.  The file is sparse, so only */
+/* the part of the ring a run actually reaches takes up disk.          */
+#define TRACE_RING_RECORDS (1 << 20)
+
+struct trace_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;     /* records in the ring */
+  uint64_t count;        /* records ever appended */
+};
+
+/* Binary trace file: a header followed by a ring of records, mapped */
+/* into memory.  Once the ring is full the oldest records are        */
+/* overwritten, so the file always holds the end of the run, even if */
+/* the process dies.                                                 */
+class TraceRing
+{
+  public:
+    TraceRing() : header(NULL), ring(NULL), length(0) {};
+    ~TraceRing();
+
+    /* create path for writing, 0 on success */
+    int create(const char *path, uint64_t capacity);
+    /* map an existing trace read-only, 0 on success */
+    int open(const char *path);
+
+    void append(const struct trace_record &r)
+    {
+      ring[header->count & (header->capacity - 1)] = r;
+      header->count++;
+    }
+
+    /* records held, the oldest first */
+    uint64_t size() const;
+    const struct trace_record &at(uint64_t i) const;
+    /* records lost to wrapping */
+    uint64_t overwritten() const;
+
+  private:
+    struct trace_file_header *header;
+    struct trace_record *ring;
+    size_t length;
+};
+
+#endif
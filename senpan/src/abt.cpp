@@ -1,4 +1,9 @@
-#include "../include/simulator.h"
+#include "../include/protocols.h"
+#include "../include/rto.h"
+#include "../include/timing_wheel.h"
+#include "../include/send_queue.h"
+#include "../include/framing.h"
+#include "../include/checksum.h"
 #include <queue>
 #include <string>
 #include <string.h>
@@ -18,204 +23,319 @@
      (although some can be lost).
 **********************************************************************/
 
-class Sender
+namespace abt {
+
+// With --channels K, K alternating-bit channels share the link.  Message
+// i goes on channel i % K with seqnum i % 2K, so a channel's bit is
+// seqnum / K and both ends can tell the channels apart without another
+// header field.  A channel only takes its next message once every
+// message before its last one is ACKed, so at most K messages are ever
+// in flight and B needs one slot per channel to put them back in order.
+class Channel
 {
   public:
     int seq_num;
-    int pkt_seq_num;
-    int state; // set the state to 0 when sender is waiting for msg, set to 1 when waiting for ACK;
+    int state; // set the state to 0 when channel is waiting for msg, set to 1 when waiting for ACK;
     float pkt_sent_time;
-    float timeout_interval;
+    bool pkt_resent; // Karn's rule: no RTT sample from a resent packet
     struct pkt last_sent_pkt;
-    std::queue<struct pkt> pkt_queue;
-    Sender() : seq_num(0), pkt_seq_num(0), state(0), pkt_sent_time(0), timeout_interval(20) {};
+    Channel() : seq_num(0), state(0), pkt_sent_time(0), pkt_resent(false) {};
 };
 
-Sender *A;
+class Sender
+{
+  public:
+    int pkt_seq_num;
+    int channels;
+    int base;        // channel of the oldest message not ACKed yet
+    int in_flight;   // messages sent and not ACKed
+    RtoEstimator rto;
+    std::vector<Channel> channel;
+    SendQueue pkt_queue;
+
+    // one timer per channel on the physical one, as in SR
+    TimingWheel timers;
+    std::vector<int> expired;
+    bool timer_running;
+    float timer_deadline;
+
+    Sender(struct sim_context *sim, int _channels, int rto_mode) : pkt_seq_num(0), channels(_channels), base(0), in_flight(0), rto(rto_mode),
+      channel(_channels), pkt_queue(sim, 0), timers(_channels, 1.0), timer_running(false), timer_deadline(0) {};
+};
 
 class Reciver
 {
   public:
-    int expected_seq;
-    Reciver() : expected_seq(0) {};
+    int channels;
+    int next;                          // channel of the next message for layer 5
+    std::vector<int> expected_seq;     // per channel
+    std::vector<struct pkt> slot;      // per channel, message waiting for layer 5
+    std::vector<bool> filled;
+    Reciver(int _channels) : channels(_channels), next(0), expected_seq(_channels), slot(_channels), filled(_channels, false)
+    {
+      for(int c = 0; c < channels; c++)
+        expected_seq[c] = c;
+    };
 };
 
-Reciver *B;
-
-int checksum(const struct pkt &p)
+class AbtProtocol : public Protocol
 {
-    uint8_t sum = 0;
-    sum += static_cast<uint8_t>(p.seqnum);
-    sum += static_cast<uint8_t>(p.acknum);
-    int payload_size = 20;
-    for(int i = 0; i < payload_size; i++)
-    {
-      sum += static_cast<uint8_t>(p.payload[i]);
-    }
-    //cast sum back to int
-    int sum_int = static_cast<int>(sum);
+  public:
+    AbtProtocol(struct sim_context *_sim) : Protocol(_sim), A(NULL), B(NULL) {};
+    ~AbtProtocol() { delete A; delete B; }
 
-    return sum_int;
-}
+    void A_output(const struct msg &message);
+    void A_input(const struct pkt &packet);
+    void A_timerinterrupt();
+    void A_init();
+    void B_input(const struct pkt &packet);
+    void B_init();
 
-bool pass_checksum(const struct pkt &p)
-{
-  return p.checksum == checksum(p);
-}
+  private:
+    Sender *A;
+    Reciver *B;
+
+    void send_paket(const struct pkt &p);
+    void send_next(const char *debug_fmt);
+    void schedule_timer();
+};
 
-void make_paket(const struct msg &msg, struct pkt &p, int seq_num, int ack_num)
+//number and checksum a packet whose payload is filled in
+void make_paket(struct sim_context *sim, struct pkt &p, int seq_num, int ack_num)
 {
   p.seqnum = seq_num;
   p.acknum = ack_num;
-  strcpy(p.payload, msg.data);
-  p.checksum = checksum(p);
+  p.checksum = checksum(sim, p);
+}
+
+//set the physical timer for the earliest channel timer, unless it
+//already goes off by then
+void AbtProtocol::schedule_timer()
+{
+  if(A->timers.size() == 0)
+    return;
+
+  float first = A->timers.next_expiry();
+  if(A->timer_running)
+  {
+    if(first >= A->timer_deadline)
+      return;
+    stoptimer(sim, 0);
+  }
+
+  float increment = first - get_sim_time(sim);
+  if(increment < 0)
+    increment = 0;
+  starttimer(sim, 0, increment);
+  A->timer_running = true;
+  A->timer_deadline = first;
 }
 
-void send_paket(const struct pkt &p)
+void AbtProtocol::send_paket(const struct pkt &p)
 {
+    Channel &ch = A->channel[p.seqnum % A->channels];
+
     //send pkt to layer 3
-    tolayer3(0, p);
-    //start timer
-    A->pkt_sent_time = get_sim_time();
-    starttimer(0, A->timeout_interval);
-    //change the sate of A to waiting for message from layer 5
-    A->state = 1;
+    tolayer3(sim, 0, p);
+    //start the channel's timer
+    ch.pkt_sent_time = get_sim_time(sim);
+    A->timers.arm(p.seqnum % A->channels, get_sim_time(sim) + A->rto.timeout());
+    schedule_timer();
+    //change the sate of the channel to waiting for ACK
+    ch.state = 1;
     //update the last sent pkt;
-    A->last_sent_pkt = p;
+    ch.last_sent_pkt = p;
+    ch.seq_num = p.seqnum;
 }
 
-void make_ack_packet(const struct pkt &packet, struct pkt &ack_pkt)
+//send buffered messages while a channel is free for them
+void AbtProtocol::send_next(const char *debug_fmt)
+{
+  while(!A->pkt_queue.empty() && A->in_flight < A->channels)
+  {
+    //prepare the packet
+    struct pkt pkt_to_send;
+    A->pkt_queue.pack(pkt_to_send);
+    make_paket(sim, pkt_to_send, A->pkt_seq_num, 0);
+    A->pkt_seq_num = (A->pkt_seq_num + 1) % (2 * A->channels);
+
+    //send packet
+    A->channel[pkt_to_send.seqnum % A->channels].pkt_resent = false;
+    A->in_flight++;
+    send_paket(pkt_to_send);
+    DEBUG_PRINTF(debug_fmt, pkt_to_send.seqnum);
+  }
+}
+
+void make_ack_packet(struct sim_context *sim, const struct pkt &packet, struct pkt &ack_pkt)
 {
   ack_pkt.seqnum = 0;
   ack_pkt.acknum = packet.seqnum;
-  memset(&ack_pkt.payload[0], 0, sizeof(ack_pkt.payload));
-  ack_pkt.checksum = checksum(ack_pkt); 
+  ack_pkt.length = 0;
+  memset(&ack_pkt.payload[0], 0, 20);
+  ack_pkt.checksum = checksum(sim, ack_pkt); 
 }
 
 /********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
 
 /* called from layer 5, passed the data to be sent to other side */
-void A_output(struct msg message)
+void AbtProtocol::A_output(const struct msg &message)
 {
-  //prepare the packet
-  struct pkt p;
-  make_paket(message, p, A->pkt_seq_num, 0);
-  A->pkt_seq_num = (A->pkt_seq_num == 0 ? 1 : 0);
-
-  //Add packet to the queue
-  A->pkt_queue.push(p);
-
-  //check the state of the sender
-  //if the state of the sender is waiting, send the message
-  printf("A is in State %d!\n", A->state);
-
-  if(A->state == 0)
+  //Add message to the queue
+  if(!A->pkt_queue.push(message))
   {
-    struct pkt pkt_to_send = A->pkt_queue.front();
-    A->pkt_queue.pop();
-
-    //send packet
-    send_paket(pkt_to_send);
-    A->seq_num = pkt_to_send.seqnum;
-    printf("Succesfully sent SEQ%d from A\n", pkt_to_send.seqnum);
+    DEBUG_PRINTF("Sending queue is full, message dropped!\n");
+    return;
   }
+
+  //send it if a channel is free for it
+  DEBUG_PRINTF("A is in State %d!\n", A->in_flight == A->channels ? 1 : 0);
+  send_next("Succesfully sent SEQ%d from A\n");
 }
 
 /* called from layer 3, when a packet arrives for layer 4 */
-void A_input(struct pkt packet)
+void AbtProtocol::A_input(const struct pkt &packet)
 {
-  //check if the ACK number is as expected, ignore if it is duplicate ACK;
-  if(packet.acknum != A->seq_num)
+  //check if the ACK number is the one its channel expects, ignore if it is duplicate ACK;
+  if(packet.acknum < 0 || packet.acknum >= 2 * A->channels ||
+     packet.acknum != A->channel[packet.acknum % A->channels].seq_num)
   {
-    printf("ACK num not matched in A side!");
+    DEBUG_PRINTF("ACK num not matched in A side!");
     return;
   }
   //check if the packet is corrupted
-  if(!pass_checksum(packet))
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, 0, 2 * A->channels))
   {
-    printf("Checksum error in A side!");
+    DEBUG_PRINTF("Checksum error in A side!");
     return;
   }
 
-  //check if A is in state of waiting for ACK
-  if(A->state == 0)
+  //check if the channel is in state of waiting for ACK
+  int c = packet.acknum % A->channels;
+  Channel &ch = A->channel[c];
+  if(ch.state == 0)
   {
-    printf("State error in A side!");
+    DEBUG_PRINTF("State error in A side!");
     return;
   }
 
-  //Successfully received the ACK for last sent pkt, 
-  //Stop the timer and change the state to wait for msg and send message in the buffer.
-  printf("Succesfully received ACK %d from B\n", packet.acknum);
+  //Successfully received the ACK for the channel's last sent pkt,
+  //Stop its timer and change the state to wait for msg.
+  DEBUG_PRINTF("Succesfully received ACK %d from B\n", packet.acknum);
 
-  stoptimer(0);
-  A->state = 0;
-
-  //check if there are still messges in the buffer to be sent
-  if(!A->pkt_queue.empty())
+  A->timers.cancel(c);
+  if(A->timers.size() == 0 && A->timer_running)
   {
-    struct pkt pkt_to_send = A->pkt_queue.front();
-    A->pkt_queue.pop();
-    send_paket(pkt_to_send);
-    A->seq_num = pkt_to_send.seqnum;
-    printf("Sent PKT %d\n", pkt_to_send.seqnum);
+    stoptimer(sim, 0);
+    A->timer_running = false;
   }
-  else
+  ch.state = 0;
+  A->rto.acked();
+  if(!ch.pkt_resent)
+    A->rto.sample(get_sim_time(sim) - ch.pkt_sent_time);
+
+  //the window moves past the channels ACKed from the oldest on
+  while(A->in_flight > 0 && A->channel[A->base].state == 0)
   {
-    printf("Buffer is empty\n");
+    A->in_flight--;
+    A->base = (A->base + 1) % A->channels;
   }
+
+  //check if there are still messges in the buffer to be sent
+  if(A->pkt_queue.empty())
+    DEBUG_PRINTF("Buffer is empty\n");
+  send_next("Sent PKT %d\n");
 }
 
 /* called when A's timer goes off */
-void A_timerinterrupt()
+void AbtProtocol::A_timerinterrupt()
 {
-    //Resend last packet
-    send_paket(A->last_sent_pkt);
-    printf("Sent PKT %d\n", A->last_sent_pkt.seqnum);
+    A->timer_running = false;
+
+    //Resend the last packet of every channel whose timer expired, with a
+    //backed off timeout
+    A->expired.clear();
+    A->timers.expire(get_sim_time(sim), A->timer_deadline, A->expired);
+    if(!A->expired.empty())
+      A->rto.backoff();
+    for(size_t i = 0; i < A->expired.size(); i++)
+    {
+      Channel &ch = A->channel[A->expired[i]];
+      ch.pkt_resent = true;
+      countretransmit(sim, 0, 1);
+      send_paket(ch.last_sent_pkt);
+      DEBUG_PRINTF("Sent PKT %d\n", ch.last_sent_pkt.seqnum);
+    }
+    schedule_timer();
 }  
 
 /* the following routine will be called once (only) before any other */
 /* entity A routines are called. You can use it to do any initialization */
-void A_init()
+void AbtProtocol::A_init()
 {
-  A = new Sender();
+  delete A;
+  A = new Sender(sim, getchannels(sim), getrtomode(sim));
 }
 
 /* Note that with simplex transfer from a-to-B, there is no B_output() */
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+void AbtProtocol::B_input(const struct pkt &packet)
 {
   //check if the packet is corrupted
-  if(!pass_checksum(packet))
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, 0, 2 * B->channels))
   {
-    printf("Checksum error in B side!");
+    DEBUG_PRINTF("Checksum error in B side!");
     return;  
   }
 
-  //send the packet to layer 5 if it is the expected packet
-  if(packet.seqnum == B->expected_seq)
+  //keep the packet if it is the one its channel expects
+  int c = packet.seqnum % B->channels;
+  if(packet.seqnum == B->expected_seq[c])
   {
-    tolayer5(1, packet.payload);
-    //update B's next expected sequence number
-    B->expected_seq = (B->expected_seq == 0 ? 1 : 0);
+    if(B->filled[c])
+    {
+      //cannot happen while A keeps its window; B has no room, no ACK
+      DEBUG_PRINTF("Channel %d of B is full!", c);
+      return;
+    }
+    B->slot[c] = packet;
+    B->filled[c] = true;
+    //update the channel's next expected sequence number
+    B->expected_seq[c] = (packet.seqnum + B->channels) % (2 * B->channels);
+
+    //send the messages to layer 5 in the order they were sent
+    while(B->filled[B->next])
+    {
+      deliver_paket(sim, 1, B->slot[B->next]);
+      B->filled[B->next] = false;
+      B->next = (B->next + 1) % B->channels;
+    }
   }
   else
   {
-    printf("Seq number %d not matched with expected Seq number %d!", packet.seqnum, B->expected_seq);
+    DEBUG_PRINTF("Seq number %d not matched with expected Seq number %d!", packet.seqnum, B->expected_seq[c]);
   }
-  
+
 
   //prepare ACK packet and reply to A
   struct pkt ack_pkt;
-  make_ack_packet(packet, ack_pkt);
-  tolayer3(1, ack_pkt);
-  printf("Sent ACK %d", ack_pkt.acknum);
+  make_ack_packet(sim, packet, ack_pkt);
+  tolayer3(sim, 1, ack_pkt);
+  DEBUG_PRINTF("Sent ACK %d", ack_pkt.acknum);
 }
 
 /* the following rouytine will be called once (only) before any other */
 /* entity B routines are called. You can use it to do any initialization */
-void B_init()
+void AbtProtocol::B_init()
 {
-  B = new Reciver();
+  delete B;
+  B = new Reciver(getchannels(sim));
 }
+
+Protocol *create(struct sim_context *sim)
+{
+  return new AbtProtocol(sim);
+}
+
+} // namespace abt
@@ -0,0 +1,42 @@
+#include "../include/ack_delay.h"
+
+AckDelay::AckDelay(struct sim_context *_sim, int _AorB)
+  : sim(_sim), AorB(_AorB), packets(getdelackpackets(_sim)),
+    time(getdelacktime(_sim)), held(0), timer_running(false)
+{
+}
+
+bool AckDelay::delay()
+{
+  if (!enabled())
+    return false;
+
+  if (++held >= packets)
+  {
+    flush();
+    return false;
+  }
+  if (!timer_running)
+  {
+    starttimer(sim, AorB, time);
+    timer_running = true;
+  }
+  return true;
+}
+
+void AckDelay::flush()
+{
+  if (timer_running)
+    stoptimer(sim, AorB);
+  timer_running = false;
+  held = 0;
+}
+
+bool AckDelay::expired()
+{
+  timer_running = false;
+  if (held == 0)
+    return false;
+  held = 0;
+  return true;
+}
@@ -0,0 +1,151 @@
+#include "../include/channel.h"
+#include <math.h>
+#include <stddef.h>
+
+const char *const buffer_policy_names[] = {"tail-drop", "red", NULL};
+
+Channel::Channel(const struct channel_params &_params) : params(_params)
+{
+  for (int i = 0; i < 2; i++)
+    dropped[i] = held[i] = queue_peak[i] = 0;
+}
+
+float Channel::hold(int to, SimRandom *rng)
+{
+  if (params.reorder <= 0 || rng->uniform(RNG_CHANNEL) >= params.reorder)
+    return 0;
+  held[to]++;
+  return params.reorder_delay * rng->uniform(RNG_CHANNEL);
+}
+
+float Channel::overtake(int to, float departed, float evtime, float gap, bool held)
+{
+  std::vector<struct holding> &h = holding[to];
+  size_t i, kept = 0;
+
+  /* those due before departed are no longer in the way */
+  for (i = 0; i < h.size(); i++)
+    if (h[i].evtime >= departed)
+      h[kept++] = h[i];
+  h.resize(kept);
+
+  /* on a tie the later packet goes first, so it must come strictly after */
+  bool moved;
+  do
+  {
+    moved = false;
+    for (i = 0; i < h.size(); i++)
+      if (h[i].overtaken >= REORDER_OVERTAKE && evtime <= h[i].evtime)
+      {
+        evtime = gap > 0 ? h[i].evtime + gap : nextafterf(h[i].evtime, HUGE_VALF);
+        moved = true;
+      }
+  } while (moved);
+  for (i = 0; i < h.size(); i++)
+    if (evtime <= h[i].evtime)
+      h[i].overtaken++;
+
+  if (held)
+  {
+    struct holding k = {evtime, 0};
+    h.push_back(k);
+  }
+  return evtime;
+}
+
+/***************************** FIFO *****************************/
+
+FifoChannel::FifoChannel(const struct channel_params &_params) : Channel(_params)
+{
+  pending[0] = pending[1] = 0;
+  tail[0] = tail[1] = 0;
+}
+
+float FifoChannel::arrival(int to, float departed, SimRandom *rng)
+{
+  /* a packet held back may still be on its way after the tail, which */
+  /* is then behind us                                                */
+  float lastime = departed;
+  if (pending[to] > 0 && tail[to] > lastime)
+    lastime = tail[to];
+  float evtime = lastime + 1 + 9 * rng->uniform(RNG_DELAY);
+  pending[to]++;
+
+  float extra = hold(to, rng);
+  evtime = overtake(to, departed, evtime + extra, evtime - lastime, extra > 0);
+  if (extra > 0)
+    return evtime;    /* the ones after it do not wait for it */
+  tail[to] = evtime;
+  return evtime;
+}
+
+/***************************** LINK *****************************/
+
+LinkChannel::LinkChannel(const struct channel_params &_params) : Channel(_params)
+{
+  average[0] = average[1] = 0;
+  tail[0] = tail[1] = 0;
+}
+
+bool LinkChannel::admit(int to, SimRandom *rng)
+{
+  int queued = leaving[to].size();
+  /* RED averages the queue every packet sees, a full one included */
+  if (params.buffer_policy == BUFFER_RED)
+    average[to] = (1 - RED_WEIGHT) * average[to] + RED_WEIGHT * queued;
+  if (queued >= params.buffer)
+    return false;
+  if (params.buffer_policy != BUFFER_RED)
+    return true;
+
+  /* RED: drop with a probability growing with the average queue */
+  /* between the two thresholds, and always above the upper one   */
+  double low = params.buffer / 4.0, high = 3 * params.buffer / 4.0;
+  if (average[to] < low)
+    return true;
+  if (average[to] >= high)
+    return false;
+  return rng->uniform(RNG_CHANNEL) >= RED_MAX_P * (average[to] - low) / (high - low);
+}
+
+float LinkChannel::send(int to, int bytes, float now, SimRandom *rng)
+{
+  std::deque<float> &q = leaving[to];
+  while (!q.empty() && q.front() <= now)
+    q.pop_front();
+
+  if (params.buffer > 0 && !admit(to, rng))
+  {
+    dropped[to]++;
+    return -1;
+  }
+
+  float start = q.empty() ? now : q.back();
+  q.push_back(start + bytes / params.bandwidth);
+  if ((int)q.size() > queue_peak[to])
+    queue_peak[to] = q.size();
+  return q.back();
+}
+
+float LinkChannel::arrival(int to, float departed, SimRandom *rng)
+{
+  float extra = hold(to, rng);
+  float evtime = departed + params.delay + extra;
+  if (extra > 0)
+    return overtake(to, departed, evtime, 0, true);
+
+  /* one that waited for a held packet keeps the ones behind it back */
+  if (evtime <= tail[to])
+    evtime = nextafterf(tail[to], HUGE_VALF);
+  tail[to] = overtake(to, departed, evtime, 0, false);
+  return tail[to];
+}
+
+/***************************** FACTORY *****************************/
+
+Channel *make_channel(const struct channel_params &params)
+{
+  if (params.bandwidth > 0)
+    return new LinkChannel(params);
+  return new FifoChannel(params);
+}
@@ -0,0 +1,215 @@
+#include "../include/checksum.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#include <nmmintrin.h>
+#define HAVE_X86 1
+#endif
+
+const char *const checksum_names[] = {"sum8", "inet", "crc32c", NULL};
+
+/* payload bytes a checksum covers */
+static int covered(const struct pkt &p)
+{
+  if (p.length <= 20)
+    return 20;
+  return p.length < PKT_MAX_PAYLOAD ? p.length : PKT_MAX_PAYLOAD;
+}
+
+int paket_checksum(int kind, const struct pkt &p)
+{
+  int size = covered(p);
+
+  switch (kind)
+  {
+    case CHECKSUM_INET:
+    {
+      uint64_t sum = 0;
+      uint32_t head[3] = {(uint32_t)p.seqnum, (uint32_t)p.acknum, (uint32_t)p.length};
+      for (int i = 0; i < 3; i++)
+        sum += (head[i] & 0xffff) + (head[i] >> 16);
+      return inet_checksum(p.payload, size, sum);
+    }
+    case CHECKSUM_CRC32C:
+    {
+      int32_t head[3] = {p.seqnum, p.acknum, p.length};
+      return (int)crc32c(crc32c(0, head, sizeof(head)), p.payload, size);
+    }
+    default:
+    {
+      uint8_t sum = 0;
+      sum += static_cast<uint8_t>(p.seqnum);
+      sum += static_cast<uint8_t>(p.acknum);
+      for (int i = 0; i < size; i++)
+        sum += static_cast<uint8_t>(p.payload[i]);
+      return sum;
+    }
+  }
+}
+
+void flip_bits(struct pkt &p, int bytes, int bits, SimRandom *rng)
+{
+  unsigned char *wire = (unsigned char *)&p;
+  int flipped[MAX_BITFLIPS];
+
+  for (int k = 0; k < bits; k++)
+  {
+    int b;
+    bool again;
+    do
+    {
+      b = (int)(rng->uniform(RNG_CORRUPT) * 8 * bytes) % (8 * bytes);
+      again = false;
+      for (int j = 0; j < k; j++)
+        again |= flipped[j] == b;
+    } while (again);
+    flipped[k] = b;
+    wire[b / 8] ^= 1 << (b % 8);
+  }
+}
+
+/* fold a sum of 16-bit words into 16 bits, end-around carries included */
+static uint16_t fold(uint64_t sum)
+{
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  return sum;
+}
+
+uint16_t inet_checksum(const void *data, size_t len, uint64_t sum)
+{
+  const unsigned char *b = (const unsigned char *)data;
+
+#ifdef __SSE2__
+  /* sixteen bytes at a time: widen the eight words to 32 bits and add */
+  /* them lane by lane; a lane takes 2^16 words before it can carry   */
+  const __m128i zero = _mm_setzero_si128();
+  while (len >= 16)
+  {
+    size_t blocks = len / 16 < 65535 ? len / 16 : 65535;
+    __m128i acc = zero;
+    for (size_t k = 0; k < blocks; k++, b += 16)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i *)b);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    len -= blocks * 16;
+  }
+#endif
+  /* eight bytes at a time, as two 32-bit halves that cannot overflow */
+  for (; len >= 8; b += 8, len -= 8)
+  {
+    uint64_t w;
+    memcpy(&w, b, 8);
+    sum += (w & 0xffffffff) + (w >> 32);
+  }
+  for (; len >= 2; b += 2, len -= 2)
+  {
+    uint16_t w;
+    memcpy(&w, b, 2);
+    sum += w;
+  }
+  /* an odd last byte is padded with a zero byte */
+  if (len)
+  {
+    uint16_t w = 0;
+    memcpy(&w, b, 1);
+    sum += w;
+  }
+  return ~fold(sum) & 0xffff;
+}
+
+/* slicing-by-8 tables of the reflected polynomial 0x82f63b78 */
+struct crc32c_tables {
+  uint32_t t[8][256];
+
+  crc32c_tables()
+  {
+    for (int n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+      t[0][n] = c;
+    }
+    for (int n = 0; n < 256; n++)
+      for (int k = 1; k < 8; k++)
+        t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+  }
+};
+
+uint32_t crc32c_table(uint32_t crc, const void *data, size_t len)
+{
+  static const struct crc32c_tables tables;
+  const uint32_t (*t)[256] = tables.t;
+  const unsigned char *b = (const unsigned char *)data;
+
+  crc = ~crc;
+  for (; len >= 8; b += 8, len -= 8)
+  {
+    uint32_t lo, hi;
+    memcpy(&lo, b, 4);
+    memcpy(&hi, b + 4, 4);
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+  for (; len > 0; b++, len--)
+    crc = (crc >> 8) ^ t[0][(crc ^ *b) & 0xff];
+  return ~crc;
+}
+
+#ifdef HAVE_X86
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t len)
+{
+  const unsigned char *b = (const unsigned char *)data;
+
+  crc = ~crc;
+#ifdef __x86_64__
+  uint64_t c = crc;
+  for (; len >= 8; b += 8, len -= 8)
+  {
+    uint64_t w;
+    memcpy(&w, b, 8);
+    c = _mm_crc32_u64(c, w);
+  }
+  crc = (uint32_t)c;
+#endif
+  for (; len >= 4; b += 4, len -= 4)
+  {
+    uint32_t w;
+    memcpy(&w, b, 4);
+    crc = _mm_crc32_u32(crc, w);
+  }
+  for (; len > 0; b++, len--)
+    crc = _mm_crc32_u8(crc, *b);
+  return ~crc;
+}
+#endif
+
+static uint32_t (*detect_crc32c())(uint32_t, const void *, size_t)
+{
+#ifdef HAVE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2"))
+    return crc32c_sse42;
+#endif
+  return NULL;
+}
+
+uint32_t (*const crc32c_hardware)(uint32_t crc, const void *data, size_t len) = detect_crc32c();
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+  if (crc32c_hardware != NULL)
+    return crc32c_hardware(crc, data, len);
+  return crc32c_table(crc, data, len);
+}
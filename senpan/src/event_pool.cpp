@@ -0,0 +1,45 @@
+#include "../include/event_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+EventPool::~EventPool()
+{
+  for (size_t i = 0; i < slabs.size(); i++)
+    free(slabs[i]);
+}
+
+struct event *EventPool::alloc()
+{
+  if (free_list == NULL)
+  {
+    struct event *slab = (struct event *)malloc(EVENT_SLAB_SIZE * sizeof(struct event));
+    if (slab == NULL)
+    {
+      printf("INTERNAL PANIC: out of memory for events\n");
+      exit(1);
+    }
+    slabs.push_back(slab);
+    /* thread the new slab onto the free list */
+    for (int i = EVENT_SLAB_SIZE - 1; i >= 0; i--)
+    {
+      slab[i].next = free_list;
+      free_list = &slab[i];
+    }
+  }
+
+  struct event *e = free_list;
+  free_list = e->next;
+
+  allocated++;
+  live++;
+  if (live > peak_live)
+    peak_live = live;
+  return e;
+}
+
+void EventPool::release(struct event *e)
+{
+  e->next = free_list;
+  free_list = e;
+  live--;
+}
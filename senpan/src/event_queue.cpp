@@ -0,0 +1,301 @@
+#include "../include/event_queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+/*************************** LIST ENGINE ***************************/
+
+void ListEventQueue::push(struct event *p)
+{
+  struct event *q, *qold;
+
+  count++;
+  q = head;
+  if (q == NULL) {   /* list is empty */
+    head = p;
+    p->next = NULL;
+    p->prev = NULL;
+    return;
+  }
+  for (qold = q; q != NULL && event_before(q, p); q = q->next)
+    qold = q;
+  if (q == NULL) {   /* end of list */
+    qold->next = p;
+    p->prev = qold;
+    p->next = NULL;
+  }
+  else if (q == head) { /* front of list */
+    p->next = head;
+    p->prev = NULL;
+    p->next->prev = p;
+    head = p;
+  }
+  else {     /* middle of list */
+    p->next = q;
+    p->prev = q->prev;
+    q->prev->next = p;
+    q->prev = p;
+  }
+}
+
+struct event *ListEventQueue::pop()
+{
+  struct event *e = head;
+  if (e != NULL)
+    remove(e);
+  return e;
+}
+
+void ListEventQueue::remove(struct event *e)
+{
+  if (e->prev != NULL)
+    e->prev->next = e->next;
+  else
+    head = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  count--;
+}
+
+void ListEventQueue::visit(event_visitor fn, void *arg)
+{
+  for (struct event *q = head; q != NULL; q = q->next)
+    fn(q, arg);
+}
+
+/*************************** HEAP ENGINE ***************************/
+
+void HeapEventQueue::place(size_t i, struct event *e)
+{
+  heap[i] = e;
+  e->qindex = i;
+}
+
+void HeapEventQueue::sift_up(size_t i)
+{
+  struct event *e = heap[i];
+  while (i > 0)
+  {
+    size_t parent = (i - 1) / arity;
+    if (!event_before(e, heap[parent]))
+      break;
+    place(i, heap[parent]);
+    i = parent;
+  }
+  place(i, e);
+}
+
+void HeapEventQueue::sift_down(size_t i)
+{
+  struct event *e = heap[i];
+  size_t n = heap.size();
+  while (true)
+  {
+    size_t first = i * arity + 1;
+    if (first >= n)
+      break;
+    size_t last = std::min(first + arity, n);
+    size_t best = first;
+    for (size_t c = first + 1; c < last; c++)
+      if (event_before(heap[c], heap[best]))
+        best = c;
+    if (!event_before(heap[best], e))
+      break;
+    place(i, heap[best]);
+    i = best;
+  }
+  place(i, e);
+}
+
+void HeapEventQueue::push(struct event *e)
+{
+  heap.push_back(e);
+  sift_up(heap.size() - 1);
+}
+
+struct event *HeapEventQueue::pop()
+{
+  if (heap.empty())
+    return NULL;
+  struct event *top = heap[0];
+  remove(top);
+  return top;
+}
+
+void HeapEventQueue::remove(struct event *e)
+{
+  size_t i = e->qindex;
+  struct event *last = heap.back();
+  heap.pop_back();
+  if (i < heap.size())
+  {
+    place(i, last);
+    sift_up(i);
+    sift_down(last->qindex);
+  }
+}
+
+void HeapEventQueue::visit(event_visitor fn, void *arg)
+{
+  for (size_t i = 0; i < heap.size(); i++)
+    fn(heap[i], arg);
+}
+
+/************************* CALENDAR ENGINE *************************/
+
+#define CALENDAR_MIN_BUCKETS 2
+#define CALENDAR_SAMPLE      25
+
+CalendarEventQueue::CalendarEventQueue()
+  : buckets(CALENDAR_MIN_BUCKETS, (struct event *)NULL), width(1.0),
+    cur_day(0), last_time(0), count(0)
+{
+}
+
+long long CalendarEventQueue::day_of(float t) const
+{
+  return (long long)floor(t / width);
+}
+
+/* insert e into its bucket, keeping the bucket sorted */
+void CalendarEventQueue::link(struct event *e)
+{
+  struct event **slot = &buckets[e->qday % (long long)buckets.size()];
+  struct event *prev = NULL;
+
+  while (*slot != NULL && event_before(*slot, e))
+  {
+    prev = *slot;
+    slot = &(*slot)->next;
+  }
+  e->prev = prev;
+  e->next = *slot;
+  if (e->next != NULL)
+    e->next->prev = e;
+  *slot = e;
+}
+
+void CalendarEventQueue::unlink(struct event *e)
+{
+  if (e->prev != NULL)
+    e->prev->next = e->next;
+  else
+    buckets[e->qday % (long long)buckets.size()] = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+}
+
+/* rebuild the calendar with nbuckets days, re-estimating the day width */
+/* from the spacing of the earliest pending events                      */
+void CalendarEventQueue::resize(size_t nbuckets)
+{
+  std::vector<struct event *> all;
+  all.reserve(count);
+  for (size_t b = 0; b < buckets.size(); b++)
+    for (struct event *q = buckets[b]; q != NULL; q = q->next)
+      all.push_back(q);
+
+  size_t sample = std::min(all.size(), (size_t)CALENDAR_SAMPLE);
+  std::partial_sort(all.begin(), all.begin() + sample, all.end(), event_before);
+  if (sample > 1)
+  {
+    double avg = (all[sample-1]->evtime - all[0]->evtime) / (sample - 1);
+    double sum = 0;
+    int n = 0;
+    for (size_t i = 1; i < sample; i++)
+    {
+      double gap = all[i]->evtime - all[i-1]->evtime;
+      if (gap <= 2 * avg)
+      {
+        sum += gap;
+        n++;
+      }
+    }
+    if (n > 0 && sum > 0)
+      width = 3 * sum / n;
+  }
+
+  buckets.assign(nbuckets, (struct event *)NULL);
+  for (size_t i = 0; i < all.size(); i++)
+  {
+    all[i]->qday = day_of(all[i]->evtime);
+    link(all[i]);
+  }
+  cur_day = all.empty() ? day_of(last_time) : all[0]->qday;
+}
+
+void CalendarEventQueue::push(struct event *e)
+{
+  e->qday = day_of(e->evtime);
+  link(e);
+  count++;
+  if (e->qday < cur_day)
+    cur_day = e->qday;
+  if (count > 2 * buckets.size())
+    resize(2 * buckets.size());
+}
+
+struct event *CalendarEventQueue::pop()
+{
+  struct event *e = NULL;
+
+  if (count == 0)
+    return NULL;
+
+  /* walk forward one day at a time for at most one year */
+  for (size_t i = 0; i < buckets.size() && e == NULL; i++)
+  {
+    struct event *head = buckets[cur_day % (long long)buckets.size()];
+    if (head != NULL && head->qday <= cur_day)
+      e = head;
+    else
+      cur_day++;
+  }
+
+  /* nothing due this year: jump straight to the earliest event */
+  if (e == NULL)
+  {
+    for (size_t b = 0; b < buckets.size(); b++)
+      if (buckets[b] != NULL && (e == NULL || event_before(buckets[b], e)))
+        e = buckets[b];
+    cur_day = e->qday;
+  }
+
+  last_time = e->evtime;
+  remove(e);
+  return e;
+}
+
+void CalendarEventQueue::remove(struct event *e)
+{
+  unlink(e);
+  count--;
+  if (buckets.size() > CALENDAR_MIN_BUCKETS && count < buckets.size() / 2)
+    resize(buckets.size() / 2);
+}
+
+void CalendarEventQueue::visit(event_visitor fn, void *arg)
+{
+  for (size_t b = 0; b < buckets.size(); b++)
+    for (struct event *q = buckets[b]; q != NULL; q = q->next)
+      fn(q, arg);
+}
+
+/***************************** FACTORY *****************************/
+
+EventQueue *make_event_queue(const char *name)
+{
+  if (strcmp(name, "list") == 0)
+    return new ListEventQueue();
+  if (strcmp(name, "calendar") == 0)
+    return new CalendarEventQueue();
+  if (strncmp(name, "heap", 4) == 0)
+  {
+    int arity = (name[4] == '\0') ? 4 : atoi(name + 4);
+    if (arity < 2)
+      return NULL;
+    return new HeapEventQueue(arity);
+  }
+  return NULL;
+}
@@ -0,0 +1,40 @@
+#include "../include/framing.h"
+#include <string.h>
+
+char *frame_message(struct pkt &p, int length, int mtu)
+{
+  if (p.length + FRAME_HEADER + length > mtu)
+    return NULL;
+
+  char *data = p.payload + p.length + FRAME_HEADER;
+  p.payload[p.length] = length & 0xff;
+  p.payload[p.length + 1] = (length >> 8) & 0xff;
+  p.length += FRAME_HEADER + length;
+  return data;
+}
+
+void deliver_paket(struct sim_context *sim, int AorB, const struct pkt &p)
+{
+  if (getmtu(sim) == 0)
+  {
+    tolayer5(sim, AorB, const_cast<char *>(p.payload));
+    return;
+  }
+
+  struct msg message;
+  int end = p.length < PKT_MAX_PAYLOAD ? p.length : PKT_MAX_PAYLOAD;
+  int at = 0;
+  while (at + FRAME_HEADER <= end)
+  {
+    message.length = (unsigned char)p.payload[at] | (unsigned char)p.payload[at + 1] << 8;
+    at += FRAME_HEADER;
+    // the checksum let this packet through, but never read past its end
+    if (message.length > end - at)
+      break;
+    memcpy(message.data, p.payload + at, message.length);
+    if (message.length < 20)
+      memset(message.data + message.length, 0, 20 - message.length);
+    tolayer5msg(sim, AorB, message);
+    at += message.length;
+  }
+}
@@ -1,4 +1,10 @@
-#include "../include/simulator.h"
+#include "../include/protocols.h"
+#include "../include/rto.h"
+#include "../include/ack_delay.h"
+#include "../include/send_queue.h"
+#include "../include/shared_timer.h"
+#include "../include/framing.h"
+#include "../include/checksum.h"
 #include <queue>
 #include <string>
 #include <string.h>
@@ -19,207 +25,458 @@
    - packets will be delivered in the order in which they were sent
      (although some can be lost).
 **********************************************************************/
+
+namespace gbn {
 class Sender
 {
   public:
+    int AorB;
     int base_num;
     int next_seqnum;
     int pkt_seqnum;
     int max_seqnum;
     int wind_size;
+    //one packet at a time is timed for an RTT sample, -1 if none is
+    int timed_seqnum;
     float pkt_sent_time;
-    float timeout_interval;
-    std::queue<struct pkt> pkt_queue;
+    RtoEstimator rto;
+    //fast retransmit after this many duplicate ACKs, 0 to wait for the timer
+    int dupack_threshold;
+    int dup_acks;
+    //last packet out at the latest go-back, -1 once it is ACKed; until
+    //then the go-back's own duplicates keep sending duplicate ACKs
+    int recover_seqnum;
+    SendQueue pkt_queue;
     std::list<struct pkt> resend_queue;
-    Sender(int _wind_size) : base_num(0), next_seqnum(0), pkt_seqnum(0), max_seqnum(2*_wind_size), wind_size(_wind_size), pkt_sent_time(0), timeout_interval(20) {};
+    Sender(struct sim_context *sim, int _AorB, int _wind_size, int rto_mode, int _dupack_threshold) : AorB(_AorB), base_num(0), next_seqnum(0), pkt_seqnum(0), max_seqnum(getseqspace(sim)), wind_size(_wind_size), timed_seqnum(-1), pkt_sent_time(0), rto(rto_mode),
+      dupack_threshold(_dupack_threshold), dup_acks(0), recover_seqnum(-1), pkt_queue(sim, _AorB) {};
 };
 
-Sender *A;
-
 class Reciver
 {
   public:
+    int AorB;
     int expected_seq;
     int last_acked;
     int max_seqnum;
-    Reciver(int _wind_size) : expected_seq(0), last_acked(-1), max_seqnum(2*_wind_size) {};
+    AckDelay delack;
+    //in bidirectional transfer: an ACK is due and waits for data to ride on
+    bool ack_owed;
+    Reciver(int _AorB, struct sim_context *sim) : AorB(_AorB), expected_seq(0), last_acked(-1), max_seqnum(getseqspace(sim)), delack(sim, _AorB), ack_owed(false) {};
 };
 
-Reciver *B;
-
-int checksum(const struct pkt &p)
+//In bidirectional transfer A and B each run a sender and a receiver.
+//A data packet carries its receiver's cumulative ACK in acknum, so the
+//ACK of in-order data, held for a while in case data goes back, costs
+//no packet; a packet of ACK alone has seqnum -1.  A to B only, the
+//packets are exactly as before.
+class GbnProtocol : public Protocol
 {
-    uint8_t sum = 0;
-    sum += static_cast<uint8_t>(p.seqnum);
-    sum += static_cast<uint8_t>(p.acknum);
-    int payload_size = 20;
-    for(int i = 0; i < payload_size; i++)
+  public:
+    GbnProtocol(struct sim_context *_sim) : Protocol(_sim), duplex(false), hold(0)
     {
-      sum += static_cast<uint8_t>(p.payload[i]);
+      sender[0] = sender[1] = NULL;
+      reciver[0] = reciver[1] = NULL;
+      timer[0] = timer[1] = NULL;
+    };
+    ~GbnProtocol()
+    {
+      for(int i = 0; i < 2; i++)
+      {
+        delete sender[i];
+        delete reciver[i];
+        delete timer[i];
+      }
     }
-    //cast sum back to int
-    int sum_int = static_cast<int>(sum);
 
-    return sum_int;
-}
+    void A_output(const struct msg &message);
+    void A_input(const struct pkt &packet);
+    void A_timerinterrupt();
+    void A_init();
+    void B_output(const struct msg &message);
+    void B_input(const struct pkt &packet);
+    void B_timerinterrupt();
+    void B_init();
 
-bool pass_checksum(const struct pkt &p)
-{
-  return p.checksum == checksum(p);
-}
+  private:
+    bool duplex;
+    //how long an ACK waits for data to ride on
+    float hold;
+    //by entity; A's receiver and B's sender only in bidirectional transfer,
+    //and a timer wherever there is a sender
+    Sender *sender[2];
+    Reciver *reciver[2];
+    SharedTimer *timer[2];
 
-void make_paket(const struct msg &msg, struct pkt &p, int seq_num, int ack_num)
+    void output(Sender *snd, const struct msg &message);
+    void ack_input(Sender *snd, const struct pkt &packet, bool piggybacked);
+    void timeout(Sender *snd);
+    void timer_interrupt(int AorB);
+    void data_input(Reciver *rcv, const struct pkt &packet);
+    void duplex_input(int AorB, const struct pkt &packet);
+    void resend_window(Sender *snd);
+    void send_next(Sender *snd);
+    void piggyback(int AorB, struct pkt &p);
+    void reply(Reciver *rcv, int acknum);
+    void send_ack(Reciver *rcv, int acknum);
+};
+
+//number and checksum a packet whose payload is filled in
+void make_paket(struct sim_context *sim, struct pkt &p, int seq_num, int ack_num)
 {
   p.seqnum = seq_num;
   p.acknum = ack_num;
-  strcpy(p.payload, msg.data);
-  p.checksum = checksum(p);
+  p.checksum = checksum(sim, p);
 }
 
-void make_ack_packet(const int acknum, struct pkt &ack_pkt)
+void make_ack_packet(struct sim_context *sim, const int acknum, struct pkt &ack_pkt)
 {
   ack_pkt.seqnum = 0;
   ack_pkt.acknum = acknum;
-  memset(&ack_pkt.payload[0], 0, sizeof(ack_pkt.payload));
-  ack_pkt.checksum = checksum(ack_pkt); 
+  ack_pkt.length = 0;
+  memset(&ack_pkt.payload[0], 0, 20);
+  ack_pkt.checksum = checksum(sim, ack_pkt); 
 }
 
-/********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
+//in bidirectional transfer a data packet of AorB, resent ones too,
+//carries the latest cumulative ACK of AorB's receiver, which then owes
+//none; being fresh on every packet it never lags one sent before it
+void GbnProtocol::piggyback(int AorB, struct pkt &p)
+{
+  if(!duplex)
+    return;
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(struct msg message)
+  Reciver *rcv = reciver[AorB];
+  if(rcv->ack_owed)
+  {
+    rcv->ack_owed = false;
+    timer[AorB]->stop(SLOT_ACK);
+    countack(sim, AorB, 1);
+  }
+  p.acknum = rcv->last_acked;
+  p.checksum = checksum(sim, p);
+}
+
+//go back: resend every unACKed packet
+void GbnProtocol::resend_window(Sender *snd)
 {
-  //prepare the packet
-  struct pkt p;
-  make_paket(message, p, A->pkt_seqnum, 0);
-  A->pkt_seqnum = (A->pkt_seqnum + 1) % A->max_seqnum;
+  //by Karn's rule take no RTT sample from resent packets
+  snd->timed_seqnum = -1;
+  snd->recover_seqnum = (snd->next_seqnum + snd->max_seqnum - 1) % snd->max_seqnum;
+  //the kept copies take the fresh ACK too, it is stamped again each time
+  for(auto& it : snd->resend_queue)
+  {
+    piggyback(snd->AorB, it);
+    tolayer3(sim, snd->AorB, it);
+  }
+  countretransmit(sim, snd->AorB, snd->resend_queue.size());
+}
 
-  //Add packet to the queue
-  A->pkt_queue.push(p);
-  //if next seq num is within the range of the window
-  if((A->next_seqnum - A->base_num + A->max_seqnum) % A->max_seqnum < A->wind_size)
+//prepare ACK packet and reply to the sender; being cumulative it covers
+//any held ACKs too
+void GbnProtocol::send_ack(Reciver *rcv, int acknum)
+{
+  rcv->delack.flush();
+  struct pkt ack_pkt;
+  make_ack_packet(sim, acknum, ack_pkt);
+  if(duplex)
+  {
+    rcv->ack_owed = false;
+    timer[rcv->AorB]->stop(SLOT_ACK);
+    ack_pkt.seqnum = -1;
+    ack_pkt.checksum = checksum(sim, ack_pkt);
+  }
+  tolayer3(sim, rcv->AorB, ack_pkt);
+  countack(sim, rcv->AorB, 0);
+  DEBUG_PRINTF("Sent ACK %d", ack_pkt.acknum);
+}
+
+//acknowledge in-order data: at once, or in bidirectional transfer on
+//the next data packet out if one leaves within the hold time
+void GbnProtocol::reply(Reciver *rcv, int acknum)
+{
+  if(!duplex)
+  {
+    send_ack(rcv, acknum);
+    return;
+  }
+  rcv->ack_owed = true;
+  if(hold > 0)
+    timer[rcv->AorB]->start(SLOT_ACK, hold);
+}
+
+//send queued messages while their seq nums are within the range of the window
+void GbnProtocol::send_next(Sender *snd)
+{
+  while(!snd->pkt_queue.empty() && (snd->next_seqnum - snd->base_num + snd->max_seqnum) % snd->max_seqnum < snd->wind_size)
   {
-    struct pkt pkt_to_send = A->pkt_queue.front();
-    A->pkt_queue.pop();
+    //prepare the packet
+    struct pkt pkt_to_send;
+    snd->pkt_queue.pack(pkt_to_send);
+    make_paket(sim, pkt_to_send, snd->pkt_seqnum, 0);
+    snd->pkt_seqnum = (snd->pkt_seqnum + 1) % snd->max_seqnum;
     //push it to the resend queue
-    A->resend_queue.push_back(pkt_to_send);
+    snd->resend_queue.push_back(pkt_to_send);
 
     //send packet
-    tolayer3(0, pkt_to_send);
+    piggyback(snd->AorB, pkt_to_send);
+    tolayer3(sim, snd->AorB, pkt_to_send);
+    if(snd->timed_seqnum == -1)
+    {
+      snd->timed_seqnum = pkt_to_send.seqnum;
+      snd->pkt_sent_time = get_sim_time(sim);
+    }
 
     //start timer if the pkt is the base pkt
-    if(A->base_num == A->next_seqnum)
-      starttimer(0, A->timeout_interval);
+    if(snd->base_num == snd->next_seqnum)
+      timer[snd->AorB]->start(SLOT_SENDER, snd->rto.timeout());
 
     //Update next seqnum
-    A->next_seqnum = (pkt_to_send.seqnum + 1) % A->max_seqnum;
+    snd->next_seqnum = (pkt_to_send.seqnum + 1) % snd->max_seqnum;
 
-    printf("Sent PKT%d from A\n", pkt_to_send.seqnum);
+    DEBUG_PRINTF("Sent PKT%d from %c\n", pkt_to_send.seqnum, 'A' + snd->AorB);
   }
-  else
+}
+
+void GbnProtocol::output(Sender *snd, const struct msg &message)
+{
+  //Add message to the queue
+  if(!snd->pkt_queue.push(message))
   {
-    printf("Sending window is full!\n");
+    DEBUG_PRINTF("Sending queue is full, message dropped!\n");
+    return;
   }
+  //if next seq num is within the range of the window
+  if((snd->next_seqnum - snd->base_num + snd->max_seqnum) % snd->max_seqnum < snd->wind_size)
+    send_next(snd);
+  else
+    DEBUG_PRINTF("Sending window is full!\n");
 }
 
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(struct pkt packet)
+//an ACK for the sender, on a packet of its own or riding on data
+void GbnProtocol::ack_input(Sender *snd, const struct pkt &packet, bool piggybacked)
 {
-  //check if the packet is corrupted
-  if(!pass_checksum(packet))
+  //data repeats the last ACK until new data arrives the other way, which
+  //says nothing about loss
+  if(piggybacked && packet.acknum == (snd->base_num + snd->max_seqnum - 1) % snd->max_seqnum)
+    return;
+
+  //the receiver repeats its last cumulative ACK for every packet after
+  //a gap; enough of them mean the base was lost, so go back right away
+  //instead of waiting for the timer, once per base and not while an
+  //earlier go-back is still being ACKed
+  if(snd->dupack_threshold > 0 && packet.acknum == (snd->base_num + snd->max_seqnum - 1) % snd->max_seqnum)
   {
-    printf("Checksum error in A side!");
+    DEBUG_PRINTF("Duplicate ACK %d\n", packet.acknum);
+    if(snd->base_num != snd->next_seqnum && snd->recover_seqnum == -1 && ++snd->dup_acks == snd->dupack_threshold)
+    {
+      DEBUG_PRINTF("Fast retransmit from PKT%d\n", snd->base_num);
+      timer[snd->AorB]->stop(SLOT_SENDER);
+      timer[snd->AorB]->start(SLOT_SENDER, snd->rto.timeout());
+      resend_window(snd);
+    }
     return;
   }
 
-  if(packet.acknum < A->base_num || packet.acknum >= (A->base_num + A->wind_size))
+  //only an ACK of a packet in flight moves the window; sequence numbers
+  //wrap, so compare distances from the base
+  if((packet.acknum - snd->base_num + snd->max_seqnum) % snd->max_seqnum >= (snd->next_seqnum - snd->base_num + snd->max_seqnum) % snd->max_seqnum)
   {
-    printf("The ack num not in the window size\n");
+    DEBUG_PRINTF("The ack num not in the window size\n");
     return;
   }
   //pop the successfully acked pkts from the resend queue
   int pkt_num;
   do
   {
-    pkt_num = A->resend_queue.front().seqnum;
-    A->resend_queue.pop_front();
+    pkt_num = snd->resend_queue.front().seqnum;
+    snd->resend_queue.pop_front();
+    if(pkt_num == snd->timed_seqnum)
+    {
+      snd->rto.sample(get_sim_time(sim) - snd->pkt_sent_time);
+      snd->timed_seqnum = -1;
+    }
+    if(pkt_num == snd->recover_seqnum)
+      snd->recover_seqnum = -1;
   }while(pkt_num != packet.acknum);
+  snd->rto.acked();
+  snd->dup_acks = 0;
 
   //Advance base num according to accumulative ack
-  A->base_num = (packet.acknum + 1) % A->max_seqnum;
+  snd->base_num = (packet.acknum + 1) % snd->max_seqnum;
 
-  if(A->base_num == A->next_seqnum)
-    stoptimer(0);
+  if(snd->base_num == snd->next_seqnum)
+    timer[snd->AorB]->stop(SLOT_SENDER);
   else
-    starttimer(0,A->timeout_interval);
+    timer[snd->AorB]->start(SLOT_SENDER, snd->rto.timeout());
+
+  //the window has moved: send what was waiting for it
+  send_next(snd);
 }
 
-/* called when A's timer goes off */
-void A_timerinterrupt()
+void GbnProtocol::timeout(Sender *snd)
 {
-  starttimer(0, A->timeout_interval);
+  snd->rto.backoff();
+  timer[snd->AorB]->start(SLOT_SENDER, snd->rto.timeout());
   
   //resend all the pkts in the resend queue
-  for(auto const& it : A->resend_queue)
-    tolayer3(0, it);
-}  
+  resend_window(snd);
+}
 
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init()
+//the timer of AorB went off: its sender timed out, or in bidirectional
+//transfer the held ACK found no data to ride on
+void GbnProtocol::timer_interrupt(int AorB)
 {
-  int wind_size = getwinsize();
-  A = new Sender(wind_size);
-}
+  unsigned due = timer[AorB]->expire();
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
+  if(due & (1u << SLOT_ACK))
+    send_ack(reciver[AorB], reciver[AorB]->last_acked);
+  if(due & (1u << SLOT_SENDER))
+    timeout(sender[AorB]);
+}
 
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+//a data packet for the receiver
+void GbnProtocol::data_input(Reciver *rcv, const struct pkt &packet)
 {
-  //check if the packet is corrupted
-  if(!pass_checksum(packet))
-  {
-    printf("Checksum error in A side!");
-    return;
-  }
-  
   //check if the Seq number is as expected, ignore if it is not;
     //send the packet to layer 5 if it is the expected packet
-  if(packet.seqnum == B->expected_seq)
+  if(packet.seqnum == rcv->expected_seq)
   {
-    tolayer5(1, packet.payload);
-    //update B's next expected sequence number
-    B->expected_seq = (B->expected_seq + 1) % B->max_seqnum;
-    //update B's last ACKed num
-    B->last_acked = packet.seqnum;
-
-    //prepare ACK packet and reply to A
-    struct pkt ack_pkt;
-    make_ack_packet(packet.seqnum, ack_pkt);
-    tolayer3(1, ack_pkt);
-    printf("Sent ACK %d", ack_pkt.acknum);
+    deliver_paket(sim, rcv->AorB, packet);
+    //update the next expected sequence number
+    rcv->expected_seq = (rcv->expected_seq + 1) % rcv->max_seqnum;
+    //update the last ACKed num
+    rcv->last_acked = packet.seqnum;
+
+    //reply to the sender, unless the ACK can wait for the next ones
+    if(!rcv->delack.delay())
+      reply(rcv, packet.seqnum);
   }
   else
   {
-    printf("Not expected sequence number!");
-    if(B->last_acked == -1)
+    DEBUG_PRINTF("Not expected sequence number!");
+    if(rcv->last_acked == -1)
       return;
     else
     {
-      //Send duplicate accumulative ack
-      struct pkt ack_pkt;
-      make_ack_packet(B->last_acked, ack_pkt);
-      tolayer3(1, ack_pkt);
-      printf("Sent ACK %d", ack_pkt.acknum);
+      //Send duplicate accumulative ack, never held: the sender counts
+      //them to see a loss
+      send_ack(rcv, rcv->last_acked);
     }
   } 
 }
 
+//a packet at AorB in bidirectional transfer: data for its receiver
+//unless seqnum is -1, and an ACK for its sender unless acknum is -1
+void GbnProtocol::duplex_input(int AorB, const struct pkt &packet)
+{
+  Reciver *rcv = reciver[AorB];
+
+  if(packet.seqnum >= 0)
+    data_input(rcv, packet);
+  if(packet.acknum >= 0)
+    ack_input(sender[AorB], packet, packet.seqnum >= 0);
+
+  //no data went out to carry the ACK and it may not wait: it goes on
+  //its own
+  if(rcv->ack_owed && hold == 0)
+    send_ack(rcv, rcv->last_acked);
+}
+
+/********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
+
+/* called from layer 5, passed the data to be sent to other side */
+void GbnProtocol::A_output(const struct msg &message)
+{
+  output(sender[0], message);
+}
+
+/* called from layer 3, when a packet arrives for layer 4 */
+void GbnProtocol::A_input(const struct pkt &packet)
+{
+  //check if the packet is corrupted
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, -1, getseqspace(sim)))
+  {
+    DEBUG_PRINTF("Checksum error in A side!");
+    return;
+  }
+
+  if(duplex)
+    duplex_input(0, packet);
+  else
+    ack_input(sender[0], packet, false);
+}
+
+/* called when A's timer goes off */
+void GbnProtocol::A_timerinterrupt()
+{
+  timer_interrupt(0);
+}  
+
+/* the following routine will be called once (only) before any other */
+/* entity A routines are called. You can use it to do any initialization */
+void GbnProtocol::A_init()
+{
+  int wind_size = getwinsize(sim);
+  duplex = getbidirectional(sim);
+  hold = getpiggybacktime(sim);
+  delete sender[0];
+  sender[0] = new Sender(sim, 0, wind_size, getrtomode(sim), getdupacks(sim));
+  delete reciver[0];
+  reciver[0] = duplex ? new Reciver(0, sim) : NULL;
+  delete timer[0];
+  timer[0] = new SharedTimer(sim, 0, duplex ? 2 : 1);
+}
+
+/* called from layer 5 at B, only in bidirectional transfer */
+void GbnProtocol::B_output(const struct msg &message)
+{
+  output(sender[1], message);
+}
+
+/* called from layer 3, when a packet arrives for layer 4 at B*/
+void GbnProtocol::B_input(const struct pkt &packet)
+{
+  //check if the packet is corrupted
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, -1, getseqspace(sim)))
+  {
+    DEBUG_PRINTF("Checksum error in A side!");
+    return;
+  }
+
+  if(duplex)
+    duplex_input(1, packet);
+  else
+    data_input(reciver[1], packet);
+}
+
+/* called when B's timer goes off: for B's sender or held ACK in         */
+/* bidirectional transfer, otherwise the delayed ACKs are due            */
+void GbnProtocol::B_timerinterrupt()
+{
+  if(duplex)
+    timer_interrupt(1);
+  else if(reciver[1]->delack.expired())
+    send_ack(reciver[1], reciver[1]->last_acked);
+}
+
 /* the following rouytine will be called once (only) before any other */
 /* entity B routines are called. You can use it to do any initialization */
-void B_init()
+void GbnProtocol::B_init()
 {
-  int wind_size = getwinsize();
-  B = new Reciver(wind_size);
+  int wind_size = getwinsize(sim);
+  duplex = getbidirectional(sim);
+  delete reciver[1];
+  reciver[1] = new Reciver(1, sim);
+  delete sender[1];
+  sender[1] = duplex ? new Sender(sim, 1, wind_size, getrtomode(sim), getdupacks(sim)) : NULL;
+  delete timer[1];
+  timer[1] = duplex ? new SharedTimer(sim, 1, 2) : NULL;
 }
+
+Protocol *create(struct sim_context *sim)
+{
+  return new GbnProtocol(sim);
+}
+
+} // namespace gbn
@@ -0,0 +1,60 @@
+#include "../include/histogram.h"
+#include <math.h>
+
+int Histogram::bucket(uint64_t units)
+{
+  if (units < HIST_SUB)
+    return (int)units;
+
+  /* units >> shift falls in [HIST_HALF, HIST_SUB) */
+  int shift = 63 - __builtin_clzll(units) - (HIST_SUB_BITS - 1);
+  return HIST_SUB + (shift - 1) * HIST_HALF + (int)((units >> shift) - HIST_HALF);
+}
+
+uint64_t Histogram::bucket_top(int b)
+{
+  if (b < HIST_SUB)
+    return b;
+
+  int shift = (b - HIST_SUB) / HIST_HALF + 1;
+  uint64_t m = (b - HIST_SUB) % HIST_HALF + HIST_HALF;
+  return ((m + 1) << shift) - 1;
+}
+
+void Histogram::record(double value)
+{
+  if (value < 0)
+    value = 0;
+
+  int b = bucket((uint64_t)llround(value / unit));
+  if (b >= (int)counts.size())
+    counts.resize(b + 1, 0);
+  counts[b]++;
+  total++;
+  sum += value;
+  if (value > max_value)
+    max_value = value;
+}
+
+double Histogram::percentile(double p) const
+{
+  if (total == 0)
+    return 0;
+
+  /* rank of the sample wanted, 1-based */
+  uint64_t rank = (uint64_t)ceil(p / 100.0 * total);
+  if (rank < 1)
+    rank = 1;
+
+  uint64_t seen = 0;
+  for (int b = 0; b < (int)counts.size(); b++)
+  {
+    seen += counts[b];
+    if (seen >= rank)
+    {
+      double top = bucket_top(b) * unit;
+      return top < max_value ? top : max_value;
+    }
+  }
+  return max_value;
+}
@@ -0,0 +1,16 @@
+#include "../include/protocols.h"
+#include <stddef.h>
+#include <string.h>
+
+const char *const protocol_names[] = { "abt", "gbn", "sr", NULL };
+
+Protocol *make_protocol(const char *name, struct sim_context *sim)
+{
+  if (strcmp(name, "abt") == 0)
+    return abt::create(sim);
+  if (strcmp(name, "gbn") == 0)
+    return gbn::create(sim);
+  if (strcmp(name, "sr") == 0)
+    return sr::create(sim);
+  return NULL;
+}
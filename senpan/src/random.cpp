@@ -0,0 +1,127 @@
+#include "../include/random.h"
+#include <string.h>
+
+/*************************** RAND() COMPAT ***************************/
+
+RandCompatRandom::RandCompatRandom(unsigned int seed)
+{
+  int32_t word = (seed == 0) ? 1 : (int32_t)seed;
+  int32_t state[34];
+
+  /* same seeding as glibc srandom_r(): 16807 * x mod (2^31 - 1) */
+  state[0] = word;
+  for (int i = 1; i < 31; i++)
+  {
+    int32_t hi = word / 127773;
+    int32_t lo = word % 127773;
+    word = 16807 * lo - 2836 * hi;
+    if (word < 0)
+      word += 2147483647;
+    state[i] = word;
+  }
+  for (int i = 31; i < 34; i++)
+    state[i] = state[i - 31];
+
+  memcpy(r, state, sizeof(r));
+  pos = 0;
+  /* glibc discards the first 310 outputs after seeding */
+  for (int i = 34; i < 344; i++)
+    next();
+
+  /* the original init() drew 1000 numbers to sanity-check rand(); */
+  /* keep drawing them so the sequence stays in step               */
+  for (int i = 0; i < 1000; i++)
+    next();
+}
+
+/* r[pos] holds value n-34; the new value is r[n-31] + r[n-3] */
+int32_t RandCompatRandom::next()
+{
+  int32_t v = (int32_t)((uint32_t)r[(pos + 3) % 34] + (uint32_t)r[(pos + 31) % 34]);
+  r[pos] = v;
+  pos = (pos + 1) % 34;
+  return (int32_t)((uint32_t)v >> 1);
+}
+
+float RandCompatRandom::uniform(int /*stream*/)
+{
+  double mmm = 2147483647;   /* RAND_MAX of glibc */
+  return next() / mmm;
+}
+
+/***************************** XOSHIRO *****************************/
+
+static inline uint64_t rotl(const uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+XoshiroRandom::XoshiroRandom(unsigned int seed)
+{
+  uint64_t x = seed;
+  for (int i = 0; i < 4; i++)
+    s[0][i] = splitmix64(&x);
+  for (int k = 1; k < RNG_STREAMS; k++)
+  {
+    memcpy(s[k], s[k - 1], sizeof(s[k]));
+    jump(s[k]);
+  }
+}
+
+uint64_t XoshiroRandom::next(uint64_t *st)
+{
+  const uint64_t result = rotl(st[1] * 5, 7) * 9;
+  const uint64_t t = st[1] << 17;
+
+  st[2] ^= st[0];
+  st[3] ^= st[1];
+  st[1] ^= st[2];
+  st[0] ^= st[3];
+  st[2] ^= t;
+  st[3] = rotl(st[3], 45);
+
+  return result;
+}
+
+/* advance the state by 2^128 draws */
+void XoshiroRandom::jump(uint64_t *st)
+{
+  static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  uint64_t t[4] = { 0, 0, 0, 0 };
+
+  for (int i = 0; i < 4; i++)
+    for (int b = 0; b < 64; b++)
+    {
+      if (JUMP[i] & (1ULL << b))
+        for (int k = 0; k < 4; k++)
+          t[k] ^= st[k];
+      next(st);
+    }
+  memcpy(st, t, sizeof(t));
+}
+
+float XoshiroRandom::uniform(int stream)
+{
+  /* top 24 bits, exactly representable as a float */
+  return (next(s[stream]) >> 40) * (1.0f / 16777216.0f);
+}
+
+/***************************** FACTORY *****************************/
+
+SimRandom *make_random(const char *name, unsigned int seed)
+{
+  if (strcmp(name, "rand") == 0)
+    return new RandCompatRandom(seed);
+  if (strcmp(name, "xoshiro") == 0)
+    return new XoshiroRandom(seed);
+  return NULL;
+}
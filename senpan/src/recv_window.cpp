@@ -0,0 +1,72 @@
+#include "../include/recv_window.h"
+#include <string.h>
+
+RecvWindow::RecvWindow(int window_size, int _max_seqnum)
+  : slots(window_size), present((window_size + 63) / 64, 0), size(window_size),
+    max_seqnum(_max_seqnum), base_num(0), count(0)
+{
+}
+
+bool RecvWindow::in_window(int seqnum) const
+{
+  return ((seqnum - base_num + max_seqnum) % max_seqnum) < size;
+}
+
+bool RecvWindow::contains(int seqnum) const
+{
+  return in_window(seqnum) && test(seqnum % size);
+}
+
+void RecvWindow::add(const struct pkt &p)
+{
+  int s = p.seqnum % size;
+  slots[s] = p;
+  present[s >> 6] |= (uint64_t)1 << (s & 63);
+  count++;
+}
+
+int RecvWindow::ready() const
+{
+  int s = base_num % size;
+  int n = 0;
+
+  /* bits past the last slot are always clear, so a run stops at the */
+  /* end of the buffer and carries on from slot 0                    */
+  while (n < count)
+  {
+    int avail = 64 - (s & 63);     /* bits left in this word */
+    uint64_t gaps = ~(present[s >> 6] >> (s & 63));
+    int run = (gaps == 0) ? avail : __builtin_ctzll(gaps);
+    n += run;
+    s += run;
+    if (s == size)
+      s = 0;
+    else if (run < avail)
+      break;
+  }
+  return n < count ? n : count;
+}
+
+void RecvWindow::sack(char *bits, int nbits) const
+{
+  memset(bits, 0, (nbits + 7) / 8);
+  if (count == 0)
+    return;
+
+  int s = (base_num + 1) % size;
+  for (int i = 0; i < nbits && i < size - 1; i++)
+  {
+    if (test(s))
+      bits[i >> 3] |= 1 << (i & 7);
+    if (++s == size)
+      s = 0;
+  }
+}
+
+void RecvWindow::pop()
+{
+  int s = base_num % size;
+  present[s >> 6] &= ~((uint64_t)1 << (s & 63));
+  count--;
+  base_num = (base_num + 1) % max_seqnum;
+}
@@ -0,0 +1,40 @@
+#include "../include/rto.h"
+#include <math.h>
+
+float RtoEstimator::timeout() const
+{
+  float t = rto;
+  for (int i = 0; i < shift && t < RTO_MAX; i++)
+    t *= 2;
+  return t < RTO_MAX ? t : RTO_MAX;
+}
+
+void RtoEstimator::sample(float rtt)
+{
+  if (mode != RTO_ADAPTIVE)
+    return;
+
+  if (srtt == 0)
+  {
+    srtt = rtt;
+    rttvar = rtt / 2;
+  }
+  else
+  {
+    /* beta = 1/4, alpha = 1/8; RTTVAR uses the old SRTT */
+    rttvar = 0.75 * rttvar + 0.25 * fabs(srtt - rtt);
+    srtt = 0.875 * srtt + 0.125 * rtt;
+  }
+
+  rto = srtt + 4 * rttvar;
+  if (rto < RTO_MIN)
+    rto = RTO_MIN;
+  if (rto > RTO_MAX)
+    rto = RTO_MAX;
+}
+
+void RtoEstimator::backoff()
+{
+  if (mode == RTO_ADAPTIVE && timeout() < RTO_MAX)
+    shift++;
+}
@@ -0,0 +1,92 @@
+#include "../include/send_queue.h"
+#include "../include/framing.h"
+#include <string.h>
+
+SendQueue::SendQueue(struct sim_context *_sim, int _AorB)
+  : sim(_sim), AorB(_AorB), limit(getqueuelimit(_sim)),
+    policy(getqueuepolicy(_sim)), blocked(false), mtu(getmtu(_sim)), head(0)
+{
+}
+
+bool SendQueue::push(const struct msg &message)
+{
+  if (limit > 0 && (int)entries.size() >= limit)
+  {
+    /* the new message is the last one layer 5 handed down, the oldest */
+    /* waiting one came size() messages before it                       */
+    if (policy != QUEUE_DROP_OLDEST)
+    {
+      dropmsg(sim, AorB, 0);
+      return false;
+    }
+    dropmsg(sim, AorB, entries.size());
+    discard();
+  }
+
+  struct entry e;
+  e.length = message.length;
+  e.queued_time = get_sim_time(sim);
+  entries.push_back(e);
+  data.resize(data.size() + message.length);
+  memcpy(&data[data.size() - message.length], message.data, message.length);
+  countqueued(sim, AorB, entries.size(), entries.size() * sizeof(struct entry) + data.size() - head);
+
+  if (policy == QUEUE_BLOCK && limit > 0 && (int)entries.size() >= limit && !blocked)
+  {
+    blocked = true;
+    blockarrivals(sim, AorB, 1);
+  }
+  return true;
+}
+
+void SendQueue::pack(struct pkt &p)
+{
+  int messages = 0;
+
+  p.length = 0;
+  do
+  {
+    int length = entries.front().length;
+    char *dest = p.payload;
+    if (mtu == 0)
+      p.length = length;
+    else if ((dest = frame_message(p, length, mtu)) == NULL)
+      break;
+    memcpy(dest, &data[head], length);
+    pop();
+    messages++;
+  } while (mtu > 0 && !entries.empty());
+
+  /* a short payload still has the 20 bytes checksums and traces cover */
+  if (p.length < 20)
+    memset(p.payload + p.length, 0, 20 - p.length);
+  countpacked(sim, AorB, messages);
+}
+
+void SendQueue::discard()
+{
+  head += entries.front().length;
+  entries.pop_front();
+  if (head == data.size())
+  {
+    data.clear();
+    head = 0;
+  }
+  else if (head > 4096 && head > data.size() / 2)
+  {
+    data.erase(data.begin(), data.begin() + head);
+    head = 0;
+  }
+}
+
+void SendQueue::pop()
+{
+  countqueuedelay(sim, AorB, get_sim_time(sim) - entries.front().queued_time);
+  discard();
+
+  if (blocked && (int)entries.size() < limit)
+  {
+    blocked = false;
+    blockarrivals(sim, AorB, 0);
+  }
+}
@@ -0,0 +1,45 @@
+#include "../include/send_window.h"
+
+SendWindow::SendWindow(int max_seqnum)
+  : slots(max_seqnum), head(-1), tail(-1)
+{
+  for (size_t i = 0; i < slots.size(); i++)
+    slots[i].unacked = false;
+}
+
+bool SendWindow::contains(int seqnum) const
+{
+  return seqnum >= 0 && seqnum < (int)slots.size() && slots[seqnum].unacked;
+}
+
+void SendWindow::add(const struct pkt &p)
+{
+  struct slot &s = slots[p.seqnum];
+  s.packet = p;
+  s.unacked = true;
+  s.prev = tail;
+  s.next = -1;
+  if (tail != -1)
+    slots[tail].next = p.seqnum;
+  else
+    head = p.seqnum;
+  tail = p.seqnum;
+}
+
+bool SendWindow::ack(int seqnum)
+{
+  if (!contains(seqnum))
+    return false;
+
+  struct slot &s = slots[seqnum];
+  s.unacked = false;
+  if (s.prev != -1)
+    slots[s.prev].next = s.next;
+  else
+    head = s.next;
+  if (s.next != -1)
+    slots[s.next].prev = s.prev;
+  else
+    tail = s.prev;
+  return true;
+}
@@ -0,0 +1,70 @@
+#include "../include/shared_timer.h"
+#include <algorithm>
+
+SharedTimer::SharedTimer(struct sim_context *_sim, int _AorB, int slots)
+  : sim(_sim), AorB(_AorB), deadlines(slots, -1), aimed(-1)
+{
+}
+
+void SharedTimer::start(int slot, float increment)
+{
+  if (deadlines.size() == 1)
+  {
+    starttimer(sim, AorB, increment);
+    return;
+  }
+  if (running(slot))
+    return;
+  deadlines[slot] = get_sim_time(sim) + increment;
+  aim();
+}
+
+void SharedTimer::stop(int slot)
+{
+  if (deadlines.size() == 1)
+  {
+    stoptimer(sim, AorB);
+    return;
+  }
+  if (!running(slot))
+    return;
+  deadlines[slot] = -1;
+  aim();
+}
+
+unsigned SharedTimer::expire()
+{
+  if (deadlines.size() == 1)
+    return 1;
+
+  /* a timer event rounded to just before aimed still stands for it */
+  float now = std::max(get_sim_time(sim), aimed);
+  unsigned due = 0;
+
+  aimed = -1;
+  for (size_t i = 0; i < deadlines.size(); i++)
+    if (running(i) && deadlines[i] <= now)
+    {
+      deadlines[i] = -1;
+      due |= 1u << i;
+    }
+  aim();
+  return due;
+}
+
+void SharedTimer::aim()
+{
+  float first = -1;
+
+  for (size_t i = 0; i < deadlines.size(); i++)
+    if (running(i) && (first < 0 || deadlines[i] < first))
+      first = deadlines[i];
+  if (first == aimed)
+    return;
+
+  if (aimed >= 0)
+    stoptimer(sim, AorB);
+  aimed = first;
+  if (first >= 0)
+    starttimer(sim, AorB, std::max(first - get_sim_time(sim), 0.0f));
+}
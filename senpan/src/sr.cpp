@@ -1,9 +1,17 @@
-#include "../include/simulator.h"
+#include "../include/protocols.h"
+#include "../include/send_window.h"
+#include "../include/recv_window.h"
+#include "../include/timing_wheel.h"
+#include "../include/rto.h"
+#include "../include/ack_delay.h"
+#include "../include/send_queue.h"
+#include "../include/shared_timer.h"
+#include "../include/framing.h"
+#include "../include/checksum.h"
 #include <queue>
 #include <string>
 #include <string.h>
 #include <vector>
-#include <map>
 #include <list>
 #include <iostream>
 #include <stdint.h>
@@ -21,359 +29,690 @@
    - packets will be delivered in the order in which they were sent
      (although some can be lost).
 **********************************************************************/
-class virtual_timer
-{
-public:
-    float time;
-    int seqnum;
-    virtual_timer(float _time,int _seqnum) : 
-        time(_time), seqnum(_seqnum) {};
-    bool operator < (const virtual_timer &time2) const
-    {
-        return time < time2.time;
-    }
-};
+
+namespace sr {
+
+//in ACK_SACK mode an ACK's payload is a bitmap of the packets B has
+//buffered after its receive base, which goes in the seqnum field; it
+//takes the 20 bytes of the original payload, whatever PKT_MAX_PAYLOAD
+#define SACK_BITS 160
 
 class Sender
 {
   public:
+    int AorB;
     int base_num;
     int next_seqnum;
     int pkt_seqnum;
     int max_seqnum;
     int wind_size;
+    //one packet at a time is timed for an RTT sample, -1 if none is
+    int timed_seqnum;
     float pkt_sent_time;
-    float timeout_interval;
-    std::queue<struct pkt> pkt_queue;
-    std::vector<struct pkt> resend_buffer;
-    std::vector<virtual_timer> virtual_timer_list;
-    Sender(int _wind_size) : base_num(0), next_seqnum(0), pkt_seqnum(0), max_seqnum(2*_wind_size), wind_size(_wind_size), pkt_sent_time(0), timeout_interval(20) {};
+    RtoEstimator rto;
+    SendQueue pkt_queue;
+    //resend buffer and the virtual timers of its packets, by seqnum
+    SendWindow window;
+    TimingWheel timers;
+    std::vector<int> expired;
+    //the physical timer, set for the earliest virtual timer
+    bool timer_running;
+    float timer_deadline;
+    bool sack;
+    Sender(struct sim_context *sim, int _AorB, int _wind_size, int rto_mode, bool _sack) : AorB(_AorB), base_num(0), next_seqnum(0), pkt_seqnum(0), max_seqnum(getseqspace(sim)), wind_size(_wind_size), timed_seqnum(-1), pkt_sent_time(0), rto(rto_mode), pkt_queue(sim, _AorB),
+      window(max_seqnum), timers(max_seqnum, 1.0), timer_running(false), timer_deadline(0), sack(_sack) {};
 };
 
-Sender *A;
-
 class Reciver
 {
   public:
-    int recv_base_num;
+    int AorB;
     int max_seqnum;
     int wind_size;
-    std::map<int, struct pkt> recv_buffer;
-
-    Reciver(int _wind_size) : recv_base_num(0), max_seqnum(2*_wind_size), wind_size(_wind_size) {};
+    //out of order packets waiting for the window base, by seqnum
+    RecvWindow recv_buffer;
+    bool sack;
+    AckDelay delack;
+    //in bidirectional transfer: the ACK of an in-order packet is due and
+    //waits for data to ride on
+    bool ack_owed;
+    int owed_acknum;
+
+    Reciver(int _AorB, int _wind_size, bool _sack, struct sim_context *sim) : AorB(_AorB), max_seqnum(getseqspace(sim)), wind_size(_wind_size), recv_buffer(_wind_size, max_seqnum), sack(_sack), delack(sim, _AorB),
+      ack_owed(false), owed_acknum(0) {};
 };
 
-Reciver *B;
-
-int checksum(const struct pkt &p)
+//In bidirectional transfer A and B each run a sender and a receiver.
+//A data packet carries in acknum the seqnum before its receiver's base,
+//a cumulative ACK, so the ACK of an in-order packet, held for a while
+//in case data goes back, costs no packet; other ACKs go at once as
+//before, on packets of their own with seqnum -1.  A to B only, the
+//packets are exactly as before.
+class SrProtocol : public Protocol
 {
-    uint8_t sum = 0;
-    sum += static_cast<uint8_t>(p.seqnum);
-    sum += static_cast<uint8_t>(p.acknum);
-    int payload_size = 20;
-    for(int i = 0; i < payload_size; i++)
+  public:
+    SrProtocol(struct sim_context *_sim) : Protocol(_sim), duplex(false), hold(0)
     {
-      sum += static_cast<uint8_t>(p.payload[i]);
+      sender[0] = sender[1] = NULL;
+      reciver[0] = reciver[1] = NULL;
+      timer[0] = timer[1] = NULL;
+    };
+    ~SrProtocol()
+    {
+      for(int i = 0; i < 2; i++)
+      {
+        delete sender[i];
+        delete reciver[i];
+        delete timer[i];
+      }
     }
-    //cast sum back to int
-    int sum_int = static_cast<int>(sum);
 
-    return sum_int;
-}
+    void A_output(const struct msg &message);
+    void A_input(const struct pkt &packet);
+    void A_timerinterrupt();
+    void A_init();
+    void B_output(const struct msg &message);
+    void B_input(const struct pkt &packet);
+    void B_timerinterrupt();
+    void B_init();
+
+  private:
+    bool duplex;
+    //how long an ACK waits for data to ride on
+    float hold;
+    //by entity; A's receiver and B's sender only in bidirectional transfer,
+    //and a timer wherever there is a sender
+    Sender *sender[2];
+    Reciver *reciver[2];
+    SharedTimer *timer[2];
+
+    void print_timer(Sender *snd);
+    void print_recv_buffer(Reciver *rcv);
+    void send_paket(Sender *snd, const struct pkt& p);
+    void resend_packet(Sender *snd, const int pkt_num);
+    void schedule_timer(Sender *snd);
+    bool release_paket(Sender *snd, int seqnum);
+    void advance_base(Sender *snd);
+    void ack_paket(Sender *snd, int ack_num);
+    void sack_paket(Sender *snd, const struct pkt &ack_pkt);
+    void cumulative_paket(Sender *snd, int recv_base);
+    void piggyback(int AorB, struct pkt &p);
+    void send_ack(Reciver *rcv, int acknum);
+    void reply(Reciver *rcv, int acknum);
+    void send_owed(Reciver *rcv);
+    void send_next(Sender *snd);
+    void output(Sender *snd, const struct msg &message);
+    void ack_input(Sender *snd, const struct pkt &packet, bool piggybacked);
+    void timeout(Sender *snd);
+    void timer_interrupt(int AorB);
+    void data_input(Reciver *rcv, const struct pkt &packet);
+    void duplex_input(int AorB, const struct pkt &packet);
+};
 
-bool pass_checksum(const struct pkt &p)
+void SrProtocol::print_timer(Sender *snd)
 {
-  return p.checksum == checksum(p);
-}
+  if(!TRACING(sim, 3))
+    return;
 
-void print_timer()
-{
-  if(!A->virtual_timer_list.empty())
+  if(!snd->window.empty())
   {
-    for(auto it : A->virtual_timer_list)
+    for(int i = snd->window.base(); i != -1; i = snd->window.next(i))
     {
-      printf("DEBUG: Interrupt time is %f for PKT %d\n", it.time, it.seqnum);
+      DEBUG_PRINTF("DEBUG: Interrupt time is %f for PKT %d\n", snd->timers.deadline(i), i);
     }
   }
   else
   {
-    printf("DEBUG: Virtual timer list is empty!\n");
+    DEBUG_PRINTF("DEBUG: Virtual timer list is empty!\n");
   }
 }
 
-void print_recv_buffer()
+void SrProtocol::print_recv_buffer(Reciver *rcv)
 {
-  if(!B->recv_buffer.empty())
+  if(!TRACING(sim, 3))
+    return;
+
+  if(!rcv->recv_buffer.empty())
   {
-    for (int i = 0; i < B->max_seqnum; i++)
-    if(B->recv_buffer.find(i) != B->recv_buffer.end())
-      printf("DEBUG: PKT %d  %s is in the recv buffer!\n", i, B->recv_buffer.at(i).payload);
+    for (int i = 0; i < rcv->max_seqnum; i++)
+    if(rcv->recv_buffer.contains(i))
+      DEBUG_PRINTF("DEBUG: PKT %d  %.20s is in the recv buffer!\n", i, rcv->recv_buffer.packet(i).payload);
   }
   else
   {
-    printf("DEBUG:Recv buffer is empty!\n");
+    DEBUG_PRINTF("DEBUG:Recv buffer is empty!\n");
   }
 }
 
-void make_paket(const struct msg &msg, struct pkt &p, int seq_num, int ack_num)
+//number and checksum a packet whose payload is filled in
+void make_paket(struct sim_context *sim, struct pkt &p, int seq_num, int ack_num)
 {
   p.seqnum = seq_num;
   p.acknum = ack_num;
-  strcpy(p.payload, msg.data);
-  p.checksum = checksum(p);
+  p.checksum = checksum(sim, p);
 }
 
-void make_ack_packet(const int acknum, struct pkt &ack_pkt)
+void make_ack_packet(struct sim_context *sim, const int acknum, struct pkt &ack_pkt)
 {
   ack_pkt.seqnum = 0;
   ack_pkt.acknum = acknum;
-  memset(&ack_pkt.payload[0], 0, sizeof(ack_pkt.payload));
-  ack_pkt.checksum = checksum(ack_pkt); 
+  ack_pkt.length = 0;
+  memset(&ack_pkt.payload[0], 0, 20);
+  ack_pkt.checksum = checksum(sim, ack_pkt); 
 }
 
-void send_paket(const struct pkt& p)
+//set the physical timer for the earliest virtual timer, unless it
+//already goes off by then
+void SrProtocol::schedule_timer(Sender *snd)
 {
-  //send pkt to layer 3
-  tolayer3(0, p);
+  if(snd->timers.size() == 0)
+    return;
 
-  //if p is the base, start timer
-  if(A->base_num == A->next_seqnum)
+  float first = snd->timers.next_expiry();
+  if(snd->timer_running)
   {
-    starttimer(0, A->timeout_interval);
+    if(first >= snd->timer_deadline)
+      return;
+    timer[snd->AorB]->stop(SLOT_SENDER);
+  }
+
+  float increment = first - get_sim_time(sim);
+  if(increment < 0)
+    increment = 0;
+  DEBUG_PRINTF("DEBUG: VIRTUAL TIMER START AT at: %f\n", increment);
+  timer[snd->AorB]->start(SLOT_SENDER, increment);
+  snd->timer_running = true;
+  snd->timer_deadline = first;
+}
+
+//in bidirectional transfer a data packet of AorB, resent ones too,
+//carries the latest cumulative ACK of AorB's receiver, which then owes
+//none; being fresh on every packet it never lags one sent before it
+void SrProtocol::piggyback(int AorB, struct pkt &p)
+{
+  if(!duplex)
+    return;
+
+  Reciver *rcv = reciver[AorB];
+  if(rcv->ack_owed)
+  {
+    rcv->ack_owed = false;
+    timer[AorB]->stop(SLOT_ACK);
+    countack(sim, AorB, 1);
   }
+  p.acknum = (rcv->recv_buffer.base() + rcv->max_seqnum - 1) % rcv->max_seqnum;
+  p.checksum = checksum(sim, p);
+}
 
-  //add virtual timer to timer list
-  A->virtual_timer_list.push_back(virtual_timer(get_sim_time() + A->timeout_interval, p.seqnum));
+void SrProtocol::send_paket(Sender *snd, const struct pkt& p)
+{
+  //send pkt to layer 3
+  struct pkt out = p;
+  piggyback(snd->AorB, out);
+  tolayer3(sim, snd->AorB, out);
 
-  //add pkt to resend buffer
-  A->resend_buffer.push_back(p);
+  //add pkt to resend buffer and start its virtual timer
+  snd->window.add(p);
+  if(snd->timed_seqnum == -1)
+  {
+    snd->timed_seqnum = p.seqnum;
+    snd->pkt_sent_time = get_sim_time(sim);
+  }
+  float deadline = get_sim_time(sim) + snd->rto.timeout();
+  snd->timers.arm(p.seqnum, deadline);
+  schedule_timer(snd);
 
   //update the next seqnum
-  A->next_seqnum = (p.seqnum + 1) % A->max_seqnum;
+  snd->next_seqnum = (p.seqnum + 1) % snd->max_seqnum;
 
-  printf("DEBUG: Sent PKT%d from A\n", p.seqnum);
-  print_timer();
+  DEBUG_PRINTF("DEBUG: Sent PKT%d from %c\n", p.seqnum, 'A' + snd->AorB);
+  print_timer(snd);
 }
 
-void resend_packet(const int pkt_num)
+void SrProtocol::resend_packet(Sender *snd, const int pkt_num)
 {
-  for(auto it : A->resend_buffer)
+  if(snd->window.contains(pkt_num))
   {
-    if(it.seqnum == pkt_num)
-    {
-      tolayer3(0, it);
-      
-      //update timer list for pkt_num
-      A->virtual_timer_list.erase(A->virtual_timer_list.begin());
-      A->virtual_timer_list.push_back(virtual_timer(get_sim_time() + A->timeout_interval, it.seqnum));
-
-      //restart timer for the first timer in the timer list
-      printf("DEBUG: VIRTUAL TIMER START AT at: %f\n",A->virtual_timer_list[0].time - get_sim_time());
-      starttimer(0, A->virtual_timer_list[0].time - get_sim_time());
-      printf("DEBUG: Resent PKT%d from A\n",pkt_num);
-      print_timer();
-      return;
-    }
+    struct pkt out = snd->window.packet(pkt_num);
+    piggyback(snd->AorB, out);
+    tolayer3(sim, snd->AorB, out);
+    countretransmit(sim, snd->AorB, 1);
+    //Karn's rule: an ACK of a resent packet gives no RTT sample
+    if(pkt_num == snd->timed_seqnum)
+      snd->timed_seqnum = -1;
+
+    //restart its virtual timer
+    float deadline = get_sim_time(sim) + snd->rto.timeout();
+    snd->timers.arm(pkt_num, deadline);
+    DEBUG_PRINTF("DEBUG: Resent PKT%d from %c\n", pkt_num, 'A' + snd->AorB);
+    return;
   }
   //else the packet not found in resend buffer
-  printf("DEBUG: time out pkt not found in resend buffer!\n");
+  DEBUG_PRINTF("DEBUG: time out pkt not found in resend buffer!\n");
 }
 
-void ack_paket(int ack_num)
+//remove the paket from the buffer list and cancel its timer; the
+//physical timer is left alone, if it goes off early it is just re-aimed
+bool SrProtocol::release_paket(Sender *snd, int seqnum)
 {
-  //remove the paket from the buffer list
-  for(int i = 0; i < A->resend_buffer.size(); i++)
+  bool acked = snd->window.ack(seqnum);
+  if(acked)
   {
-    if(A->resend_buffer[i].seqnum == ack_num)
+    snd->rto.acked();
+    if(seqnum == snd->timed_seqnum)
     {
-      A->resend_buffer.erase(A->resend_buffer.begin() + i);
+      snd->rto.sample(get_sim_time(sim) - snd->pkt_sent_time);
+      snd->timed_seqnum = -1;
     }
   }
+  if(seqnum >= 0 && seqnum < snd->max_seqnum)
+    snd->timers.cancel(seqnum);
+  return acked;
+}
+
+//move the base up to the oldest unACKed packet
+void SrProtocol::advance_base(Sender *snd)
+{
+  if(snd->window.empty())
+  {
+    if(snd->timer_running)
+      timer[snd->AorB]->stop(SLOT_SENDER);
+    snd->timer_running = false;
+    snd->base_num = snd->next_seqnum;
+  }
+  else
+  {
+    snd->base_num = snd->window.base();
+  }
+}
+
+void SrProtocol::ack_paket(Sender *snd, int ack_num)
+{
+  release_paket(snd, ack_num);
+
+  //advance the base if pkt_num is the base
+  if(snd->window.empty() || snd->base_num == ack_num)
+    advance_base(snd);
 
-  //remove its timer from the timer list
-  for(int i = 0; i < A->virtual_timer_list.size(); i++)
+  print_timer(snd);
+}
+
+//release every packet in flight that a selective ACK covers: the one it
+//ACKs, those before the receive base and those set in its bitmap
+void SrProtocol::sack_paket(Sender *snd, const struct pkt &ack_pkt)
+{
+  int recv_base = ack_pkt.seqnum;
+  int cumulative = (recv_base - snd->base_num + snd->max_seqnum) % snd->max_seqnum;
+  //an old ACK whose base is behind ours says nothing beyond its acknum;
+  //a base a whole window ahead is current only if it ACKs the last sent
+  bool current = cumulative < snd->wind_size ||
+                 (cumulative == snd->wind_size && ack_pkt.acknum == (snd->next_seqnum + snd->max_seqnum - 1) % snd->max_seqnum);
+  int released = 0;
+
+  for(int s = snd->window.base(); s != -1; )
   {
-    if(A->virtual_timer_list[i].seqnum == ack_num)
+    int next = snd->window.next(s);
+    int before = (s - snd->base_num + snd->max_seqnum) % snd->max_seqnum;
+    int after = (s - recv_base + snd->max_seqnum) % snd->max_seqnum - 1;
+    if(s == ack_pkt.acknum ||
+       (current && before < cumulative) ||
+       (current && after >= 0 && after < SACK_BITS && ((ack_pkt.payload[after >> 3] >> (after & 7)) & 1)))
     {
-      A->virtual_timer_list.erase(A->virtual_timer_list.begin() + i);
+      release_paket(snd, s);
+      released++;
     }
+    s = next;
   }
 
-  if(A->resend_buffer.empty())
+  DEBUG_PRINTF("DEBUG: SACK base %d released %d packets\n", recv_base, released);
+  if(released > 0)
+    advance_base(snd);
+  print_timer(snd);
+}
+
+//release every packet in flight before the receive base a piggybacked
+//ACK names; it is never behind our base, as the one before it was not
+void SrProtocol::cumulative_paket(Sender *snd, int recv_base)
+{
+  int cumulative = (recv_base - snd->base_num + snd->max_seqnum) % snd->max_seqnum;
+  int released = 0;
+
+  if(cumulative > snd->wind_size)
+    return;
+  for(int s = snd->window.base(); s != -1; )
   {
-    stoptimer(0);
-    A->base_num = A->next_seqnum;
+    int next = snd->window.next(s);
+    if((s - snd->base_num + snd->max_seqnum) % snd->max_seqnum < cumulative)
+    {
+      release_paket(snd, s);
+      released++;
+    }
+    s = next;
   }
-  //update the timer and advance the base if pkt_num is the base
-  else if(A->base_num == ack_num)
+
+  if(released > 0)
   {
-    //resart the timer
-    stoptimer(0);
-    
-    printf("DEBUG: VIRTUAL TIMER START AT at: %f\n",A->virtual_timer_list[0].time - get_sim_time());
-    starttimer(0, A->virtual_timer_list[0].time - get_sim_time());
+    DEBUG_PRINTF("DEBUG: Piggybacked ACK base %d released %d packets\n", recv_base, released);
+    advance_base(snd);
+    print_timer(snd);
+  }
+}
 
-    A->base_num = A->resend_buffer[0].seqnum;
+//the receiver acknowledges acknum, in ACK_SACK mode along with its
+//whole window and so with any held ACKs
+void SrProtocol::send_ack(Reciver *rcv, int acknum)
+{
+  rcv->delack.flush();
+  struct pkt ack_pkt;
+  make_ack_packet(sim, acknum, ack_pkt);
+  if(rcv->sack)
+  {
+    ack_pkt.seqnum = rcv->recv_buffer.base();
+    rcv->recv_buffer.sack(ack_pkt.payload, SACK_BITS);
+    ack_pkt.length = SACK_BITS / 8;
+    ack_pkt.checksum = checksum(sim, ack_pkt);
   }
+  else if(duplex)
+  {
+    ack_pkt.seqnum = -1;
+    ack_pkt.checksum = checksum(sim, ack_pkt);
+  }
+  tolayer3(sim, rcv->AorB, ack_pkt);
+  countack(sim, rcv->AorB, 0);
+}
 
-  print_timer();
+//acknowledge an in-order packet: at once, or in bidirectional transfer
+//on the next data packet out, whose cumulative ACK covers it, if one
+//leaves within the hold time
+void SrProtocol::reply(Reciver *rcv, int acknum)
+{
+  if(!duplex)
+  {
+    send_ack(rcv, acknum);
+    return;
+  }
+  //an ACK on its own covers one packet only, so one is held at a time
+  if(rcv->ack_owed)
+    send_owed(rcv);
+  rcv->ack_owed = true;
+  rcv->owed_acknum = acknum;
+  if(hold > 0)
+    timer[rcv->AorB]->start(SLOT_ACK, hold);
 }
 
+//the held ACK goes on its own
+void SrProtocol::send_owed(Reciver *rcv)
+{
+  rcv->ack_owed = false;
+  timer[rcv->AorB]->stop(SLOT_ACK);
+  send_ack(rcv, rcv->owed_acknum);
+}
 
-/********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(struct msg message)
+//send queued messages while their seq nums fall into the range of the window
+void SrProtocol::send_next(Sender *snd)
 {
-  //prepare the packet
-  struct pkt p;
-  make_paket(message, p, A->pkt_seqnum, 0);
-  A->pkt_seqnum = (A->pkt_seqnum + 1) % A->max_seqnum;
+  while((snd->next_seqnum != (snd->base_num + snd->wind_size)%snd->max_seqnum) && !snd->pkt_queue.empty())
+  {
+    //prepare the packet
+    struct pkt pkt_to_send;
+    snd->pkt_queue.pack(pkt_to_send);
+    make_paket(sim, pkt_to_send, snd->pkt_seqnum, 0);
+    snd->pkt_seqnum = (snd->pkt_seqnum + 1) % snd->max_seqnum;
+    send_paket(snd, pkt_to_send);
+  }
+}
 
-  //Add packet to the queue
-  A->pkt_queue.push(p);
+void SrProtocol::output(Sender *snd, const struct msg &message)
+{
+  //Add message to the queue
+  if(!snd->pkt_queue.push(message))
+  {
+    DEBUG_PRINTF("DEBUG: Sending queue is full, message dropped!\n");
+    return;
+  }
 
   //if next seq num is within the range of the window
-  if((A->next_seqnum - A->base_num + A->max_seqnum) % A->max_seqnum < A->wind_size)
+  if((snd->next_seqnum - snd->base_num + snd->max_seqnum) % snd->max_seqnum < snd->wind_size)
   {
-    struct pkt pkt_to_send = A->pkt_queue.front();
-    A->pkt_queue.pop();
-    send_paket(pkt_to_send);
+    send_next(snd);
   }
   else
   {
-    printf("DEBUG: Sending window is full!\n");
+    DEBUG_PRINTF("DEBUG: Sending window is full!\n");
   }
 }
 
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(struct pkt packet)
+//an ACK for the sender, on a packet of its own or riding on data
+void SrProtocol::ack_input(Sender *snd, const struct pkt &packet, bool piggybacked)
 {
- //check if the packet is corrupted
-  if(!pass_checksum(packet))
+  if(piggybacked)
   {
-    printf("DEBUG: Checksum error in A side!\n");
-    return;
+    cumulative_paket(snd, (packet.acknum + 1) % snd->max_seqnum);
   }
-
-  if(packet.acknum < A->base_num || packet.acknum >= (A->base_num + A->wind_size))
+  else if(snd->sack)
+  {
+    sack_paket(snd, packet);
+  }
+  //sequence numbers wrap, so compare distances from the base
+  else if((packet.acknum - snd->base_num + snd->max_seqnum) % snd->max_seqnum >= snd->wind_size)
   {
-    printf("DEBUG: The ack num not in the window size\n");
+    DEBUG_PRINTF("DEBUG: The ack num not in the window size\n");
     return;
   }
-
-  ack_paket(packet.acknum);
+  else
+  {
+    ack_paket(snd, packet.acknum);
+  }
 
   //check if there are new packets fall into the range of the window.
   //send these packets if yes
-  while((A->next_seqnum != (A->base_num + A->wind_size)%A->max_seqnum) && !A->pkt_queue.empty())
-  {
-    struct pkt pkt_to_send = A->pkt_queue.front();
-    A->pkt_queue.pop();
-    send_paket(pkt_to_send);
-  }
+  send_next(snd);
 }
 
-/* called when A's timer goes off */
-void A_timerinterrupt()
+void SrProtocol::timeout(Sender *snd)
 {
-  //resend the timeout packet
-  int timeout_pkt = A->virtual_timer_list[0].seqnum;
-  resend_packet(timeout_pkt);
-}  
+  snd->timer_running = false;
+
+  //resend every packet whose virtual timer has expired by now
+  snd->expired.clear();
+  snd->timers.expire(get_sim_time(sim), snd->timer_deadline, snd->expired);
+  if(!snd->expired.empty())
+    snd->rto.backoff();
+  for(size_t i = 0; i < snd->expired.size(); i++)
+    resend_packet(snd, snd->expired[i]);
+
+  schedule_timer(snd);
+  print_timer(snd);
+}
 
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init()
+//the timer of AorB went off: for its sender's virtual timers, or in
+//bidirectional transfer the held ACK found no data to ride on
+void SrProtocol::timer_interrupt(int AorB)
 {
-  int wind_size = getwinsize();
-  A = new Sender(wind_size);
-}
+  unsigned due = timer[AorB]->expire();
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
+  if(due & (1u << SLOT_ACK))
+    send_owed(reciver[AorB]);
+  if(due & (1u << SLOT_SENDER))
+    timeout(sender[AorB]);
+}
 
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+//a data packet for the receiver
+void SrProtocol::data_input(Reciver *rcv, const struct pkt &packet)
 {
-  //check if the packet is corrupted
-  if(!pass_checksum(packet))
-  {
-    printf("DEBUG: Checksum error in B side!\n");
-    return;
-  }
-
   //if the packt seq num fall within the recv window
-  printf("DEBUG: Calculation result is: %d\n", ((packet.seqnum - B->recv_base_num + B->max_seqnum) % B->max_seqnum) < B->wind_size);
-  if(((packet.seqnum - B->recv_base_num + B->max_seqnum) % B->max_seqnum) < B->wind_size)
+  DEBUG_PRINTF("DEBUG: Calculation result is: %d\n", rcv->recv_buffer.in_window(packet.seqnum));
+  if(rcv->recv_buffer.in_window(packet.seqnum))
   {
-    printf("DEBUG: Entered if\n");
+    DEBUG_PRINTF("DEBUG: Entered if\n");
     //check if the paket has already been received
-    if(B->recv_buffer.find(packet.seqnum) == B->recv_buffer.end())
+    if(!rcv->recv_buffer.contains(packet.seqnum))
     {
-      B->recv_buffer.insert(std::pair<int, struct pkt>(packet.seqnum, packet));
-      // std::sort(B->recv_buffer.begin(), B->recv_buffer.end());
-      printf("DEBUG: Added PKT%d into receiver buffer\n", packet.seqnum);
-      if(packet.seqnum == B->recv_base_num)
+      rcv->recv_buffer.add(packet);
+      DEBUG_PRINTF("DEBUG: Added PKT%d into receiver buffer\n", packet.seqnum);
+      if(packet.seqnum == rcv->recv_buffer.base())
       {
-        printf("DEBUG: To Layer5 1\n");
-        tolayer5(1, packet.payload);
-        B->recv_buffer.erase(B->recv_base_num);
-        //ACK packet
-        struct pkt ack_pkt;
-        make_ack_packet(packet.seqnum, ack_pkt);
-        tolayer3(1, ack_pkt);
-
+        DEBUG_PRINTF("DEBUG: To Layer5 1\n");
+        deliver_paket(sim, rcv->AorB, packet);
         //increment base num
-        B->recv_base_num = (B->recv_base_num + 1) % B->max_seqnum;
-        while(B->recv_buffer.find(B->recv_base_num) != B->recv_buffer.end())
+        rcv->recv_buffer.pop();
+        //ACK packet; one that fills a gap goes out at once, others may
+        //wait for the next ones
+        if(rcv->recv_buffer.ready() > 0 || !rcv->delack.delay())
+          reply(rcv, packet.seqnum);
+
+        //deliver the run of buffered packets that now follow in order
+        for(int n = rcv->recv_buffer.ready(); n > 0; n--)
         {
-          printf("DEBUG: To Layer5 2\n");
-          tolayer5(1, B->recv_buffer.at(B->recv_base_num).payload);
-          B->recv_buffer.erase(B->recv_base_num);
-
-          //increment base num
-          B->recv_base_num = (B->recv_base_num + 1) % B->max_seqnum;          
+          DEBUG_PRINTF("DEBUG: To Layer5 2\n");
+          deliver_paket(sim, rcv->AorB, rcv->recv_buffer.packet(rcv->recv_buffer.base()));
+          rcv->recv_buffer.pop();
         }
       }
       else
       {
         //out of order packet in the window range
         //ACK packet
-        struct pkt ack_pkt;
-        make_ack_packet(packet.seqnum, ack_pkt);
-        tolayer3(1, ack_pkt);
+        send_ack(rcv, packet.seqnum);
       }
       
-      print_recv_buffer();
+      print_recv_buffer(rcv);
     }
     else
     {
       //The packet has been received, send duplicate ack
       //Packet seq num is out of window range, Send duplicate ack
-      struct pkt ack_pkt;
-      make_ack_packet(packet.seqnum, ack_pkt);
-      tolayer3(1, ack_pkt);
-      printf("DEBUG: Sent ACK %d for duplicate packet in window range!\n", ack_pkt.acknum);
+      send_ack(rcv, packet.seqnum);
+      DEBUG_PRINTF("DEBUG: Sent ACK %d for duplicate packet in window range!\n", packet.seqnum);
       
-      print_recv_buffer();
+      print_recv_buffer(rcv);
     }
   }
   else
   {
     //Packet seq num is out of window range, Send duplicate ack
-    struct pkt ack_pkt;
-    make_ack_packet(packet.seqnum, ack_pkt);
-    tolayer3(1, ack_pkt);
-    printf("DEBUG: Sent ACK %d for duplicate packet out of window range!\n", ack_pkt.acknum);
+    send_ack(rcv, packet.seqnum);
+    DEBUG_PRINTF("DEBUG: Sent ACK %d for duplicate packet out of window range!\n", packet.seqnum);
 
-    print_recv_buffer();
+    print_recv_buffer(rcv);
   }
 }
 
+//a packet at AorB in bidirectional transfer: data for its receiver
+//unless seqnum is -1; its acknum is an ACK for AorB's sender, a
+//cumulative one if the packet carries data
+void SrProtocol::duplex_input(int AorB, const struct pkt &packet)
+{
+  Reciver *rcv = reciver[AorB];
+
+  if(packet.seqnum >= 0)
+    data_input(rcv, packet);
+  if(packet.acknum >= 0)
+    ack_input(sender[AorB], packet, packet.seqnum >= 0);
+
+  //no data went out to carry the ACK and it may not wait: it goes on
+  //its own
+  if(rcv->ack_owed && hold == 0)
+    send_owed(rcv);
+}
+
+/********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
+
+/* called from layer 5, passed the data to be sent to other side */
+void SrProtocol::A_output(const struct msg &message)
+{
+  output(sender[0], message);
+}
+
+/* called from layer 3, when a packet arrives for layer 4 */
+void SrProtocol::A_input(const struct pkt &packet)
+{
+ //check if the packet is corrupted
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, -1, getseqspace(sim)))
+  {
+    DEBUG_PRINTF("DEBUG: Checksum error in A side!\n");
+    return;
+  }
+
+  if(duplex)
+    duplex_input(0, packet);
+  else
+    ack_input(sender[0], packet, false);
+}
+
+/* called when A's timer goes off */
+void SrProtocol::A_timerinterrupt()
+{
+  timer_interrupt(0);
+}  
+
+/* the following routine will be called once (only) before any other */
+/* entity A routines are called. You can use it to do any initialization */
+void SrProtocol::A_init()
+{
+  int wind_size = getwinsize(sim);
+  duplex = getbidirectional(sim);
+  hold = getpiggybacktime(sim);
+  delete sender[0];
+  sender[0] = new Sender(sim, 0, wind_size, getrtomode(sim), getackmode(sim) == ACK_SACK || getdelackpackets(sim) > 0);
+  delete reciver[0];
+  reciver[0] = duplex ? new Reciver(0, wind_size, false, sim) : NULL;
+  delete timer[0];
+  timer[0] = new SharedTimer(sim, 0, duplex ? 2 : 1);
+}
+
+/* called from layer 5 at B, only in bidirectional transfer */
+void SrProtocol::B_output(const struct msg &message)
+{
+  output(sender[1], message);
+}
+
+/* called from layer 3, when a packet arrives for layer 4 at B*/
+void SrProtocol::B_input(const struct pkt &packet)
+{
+  //check if the packet is corrupted
+  if(!pass_checksum(sim, packet) || !numbers_valid(packet, -1, getseqspace(sim)))
+  {
+    DEBUG_PRINTF("DEBUG: Checksum error in B side!\n");
+    return;
+  }
+
+  if(duplex)
+    duplex_input(1, packet);
+  else
+    data_input(reciver[1], packet);
+}
+
+/* called when B's timer goes off: for B's sender or held ACK in         */
+/* bidirectional transfer, otherwise the delayed ACKs are due            */
+void SrProtocol::B_timerinterrupt()
+{
+  if(duplex)
+    timer_interrupt(1);
+  else if(reciver[1]->delack.expired())
+    send_ack(reciver[1], (reciver[1]->recv_buffer.base() + reciver[1]->max_seqnum - 1) % reciver[1]->max_seqnum);
+}
+
 /* the following routine will be called once (only) before any other */
 /* entity B routines are called. You can use it to do any initialization */
-void B_init()
+void SrProtocol::B_init()
 {
-  int wind_size = getwinsize();
-  B = new Reciver(wind_size);
+  int wind_size = getwinsize(sim);
+  //delayed ACKs must be cumulative, so they are selective ACKs
+  bool sack = getackmode(sim) == ACK_SACK || getdelackpackets(sim) > 0;
+  duplex = getbidirectional(sim);
+  delete reciver[1];
+  reciver[1] = new Reciver(1, wind_size, sack, sim);
+  delete sender[1];
+  sender[1] = duplex ? new Sender(sim, 1, wind_size, getrtomode(sim), false) : NULL;
+  delete timer[1];
+  timer[1] = duplex ? new SharedTimer(sim, 1, 2) : NULL;
 }
+
+Protocol *create(struct sim_context *sim)
+{
+  return new SrProtocol(sim);
+}
+
+} // namespace sr
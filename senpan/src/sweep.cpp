@@ -0,0 +1,107 @@
+#include "../include/sweep.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/* counters of one finished run, i.e. one CSV row */
+struct sweep_result {
+  struct sim_params params;
+  int A_application;
+  int A_transport;
+  int B_transport;
+  int B_application;
+  int A_retransmit;
+  long bytes_delivered;
+  float time_local;
+};
+
+static void sweep_worker(std::vector<struct sweep_result> *jobs, std::atomic<size_t> *next)
+{
+  size_t i;
+  while ((i = (*next)++) < jobs->size())
+  {
+    struct sweep_result &r = (*jobs)[i];
+    struct sim_context ctx(r.params);
+
+    run_simulation(&ctx);
+
+    r.A_application = ctx.A_application;
+    r.A_transport = ctx.A_transport;
+    r.B_transport = ctx.B_transport;
+    r.B_application = ctx.B_application;
+    r.A_retransmit = ctx.A_retransmit;
+    r.bytes_delivered = ctx.app_bytes_in[1];
+    r.time_local = ctx.time_local;
+  }
+}
+
+int run_sweep(const struct sweep_grid &grid, int workers, const char *path)
+{
+  std::vector<struct sweep_result> jobs;
+
+  for (size_t p = 0; p < grid.protocols.size(); p++)
+    for (size_t o = 0; o < grid.rto_modes.size(); o++)
+      for (size_t m = 0; m < grid.messages.size(); m++)
+        for (size_t l = 0; l < grid.losses.size(); l++)
+          for (size_t c = 0; c < grid.corruptions.size(); c++)
+            for (size_t t = 0; t < grid.times.size(); t++)
+              for (size_t s = 0; s < grid.seeds.size(); s++)
+              {
+                struct sweep_result r = {};
+                r.params = grid.base;
+                r.params.protocol = grid.protocols[p];
+                r.params.rto_mode = grid.rto_modes[o];
+                r.params.nsimmax = grid.messages[m];
+                r.params.lossprob = grid.losses[l];
+                r.params.corruptprob = grid.corruptions[c];
+                r.params.lambda = grid.times[t];
+                r.params.seed = grid.seeds[s];
+                jobs.push_back(r);
+              }
+
+  FILE *out = fopen(path, "w");
+  if (out == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for (int w = 0; w < workers; w++)
+    pool.push_back(std::thread(sweep_worker, &jobs, &next));
+  for (size_t w = 0; w < pool.size(); w++)
+    pool[w].join();
+
+  bool by_protocol = grid.protocols.size() > 1;
+  bool by_rto = grid.rto_modes.size() > 1;
+  if (by_protocol)
+    fprintf(out, "Protocol,");
+  if (by_rto)
+    fprintf(out, "RTO,");
+  fprintf(out, "Run,Messages,Loss,Corruption,Time_bw_messages,Application_A,Transport_A,Transport_B,Application_B,Total_time,Throughput");
+  bool framed = grid.base.mtu > 0;
+  if (by_rto)
+    fprintf(out, ",Retransmissions");
+  fprintf(out, framed ? ",Goodput\n" : "\n");
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    const struct sweep_result &r = jobs[i];
+    if (by_protocol)
+      fprintf(out, "%s,", r.params.protocol);
+    if (by_rto)
+      fprintf(out, "%s,", rto_mode_names[r.params.rto_mode]);
+    fprintf(out, "%d,%d,%g,%g,%g,%d,%d,%d,%d,%f,%f",
+            r.params.seed, r.params.nsimmax, r.params.lossprob, r.params.corruptprob,
+            r.params.lambda, r.A_application, r.A_transport, r.B_transport,
+            r.B_application, r.time_local, r.B_application / r.time_local);
+    if (by_rto)
+      fprintf(out, ",%d", r.A_retransmit);
+    if (framed)
+      fprintf(out, ",%f", r.bytes_delivered / r.time_local);
+    fprintf(out, "\n");
+  }
+  fclose(out);
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include "../include/timing_wheel.h"
+#include <math.h>
+
+#define OVERFLOW_SLOT (WHEEL_LEVELS * WHEEL_SLOTS)
+
+TimingWheel::TimingWheel(int capacity, double _tick)
+  : timers(capacity), tick(_tick), cur(0), count(0)
+{
+  for (int i = 0; i < capacity; i++)
+    timers[i].slot = -1;
+  for (int i = 0; i <= OVERFLOW_SLOT; i++)
+    slots[i] = -1;
+  for (int l = 0; l < WHEEL_LEVELS; l++)
+    occupied[l] = 0;
+}
+
+/* link timer id into the slot its tick belongs to, seen from cur */
+void TimingWheel::place(int id)
+{
+  struct timer &t = timers[id];
+  long long expires = t.expires < cur ? cur : t.expires;
+  int level = 0;
+  long long index;
+
+  while (level < WHEEL_LEVELS - 1 &&
+         (expires >> (level * WHEEL_BITS)) - (cur >> (level * WHEEL_BITS)) >= WHEEL_SLOTS)
+    level++;
+  index = expires >> (level * WHEEL_BITS);
+
+  int s = level * WHEEL_SLOTS + (int)(index & (WHEEL_SLOTS - 1));
+  /* beyond the top wheel: wait for it to come round */
+  if (index - (cur >> (level * WHEEL_BITS)) >= WHEEL_SLOTS)
+    s = OVERFLOW_SLOT;
+  t.slot = s;
+  t.prev = -1;
+  t.next = slots[s];
+  if (t.next != -1)
+    timers[t.next].prev = id;
+  slots[s] = id;
+  if (s != OVERFLOW_SLOT)
+    occupied[level] |= (uint64_t)1 << (s & (WHEEL_SLOTS - 1));
+}
+
+void TimingWheel::unlink(int id)
+{
+  struct timer &t = timers[id];
+  if (t.prev != -1)
+    timers[t.prev].next = t.next;
+  else
+    slots[t.slot] = t.next;
+  if (t.next != -1)
+    timers[t.next].prev = t.prev;
+  if (slots[t.slot] == -1 && t.slot != OVERFLOW_SLOT)
+    occupied[t.slot / WHEEL_SLOTS] &= ~((uint64_t)1 << (t.slot & (WHEEL_SLOTS - 1)));
+  t.slot = -1;
+}
+
+void TimingWheel::arm(int id, double deadline)
+{
+  if (armed(id))
+    unlink(id);
+  else
+    count++;
+  timers[id].deadline = deadline;
+  timers[id].expires = (long long)floor(deadline / tick);
+  place(id);
+}
+
+void TimingWheel::cancel(int id)
+{
+  if (!armed(id))
+    return;
+  unlink(id);
+  count--;
+}
+
+/* the wheel reached the current slot of level: spread it over the */
+/* levels below.  Level WHEEL_LEVELS is the overflow list.         */
+void TimingWheel::cascade(int level)
+{
+  int s = OVERFLOW_SLOT;
+  if (level < WHEEL_LEVELS)
+  {
+    s = level * WHEEL_SLOTS + (int)((cur >> (level * WHEEL_BITS)) & (WHEEL_SLOTS - 1));
+    occupied[level] &= ~((uint64_t)1 << (s & (WHEEL_SLOTS - 1)));
+  }
+  int id = slots[s];
+  slots[s] = -1;
+  while (id != -1)
+  {
+    int next = timers[id].next;
+    place(id);
+    id = next;
+  }
+}
+
+void TimingWheel::advance(double now, std::vector<int> &expired)
+{
+  long long target = (long long)floor(now / tick);
+
+  while (true)
+  {
+    int s = (int)(cur & (WHEEL_SLOTS - 1));
+    int id = slots[s];
+    while (id != -1)
+    {
+      int next = timers[id].next;
+      if (timers[id].deadline <= now)
+      {
+        unlink(id);
+        count--;
+        expired.push_back(id);
+      }
+      id = next;
+    }
+    if (cur >= target)
+      break;
+    if (count == 0)
+    {
+      cur = target;
+      break;
+    }
+
+    /* step a tick at a time while the lowest wheel holds timers; */
+    /* otherwise jump to where the lowest non-empty level cascades */
+    int low = 0;
+    while (low < WHEEL_LEVELS && occupied[low] == 0)
+      low++;
+    if (low == 0)
+      cur++;
+    else
+    {
+      long long next = ((cur >> (low * WHEEL_BITS)) + 1) << (low * WHEEL_BITS);
+      if (next > target)
+      {
+        cur = target;
+        continue;
+      }
+      cur = next;
+    }
+    for (int l = WHEEL_LEVELS; l > 0; l--)
+      if ((cur & (((long long)1 << (l * WHEEL_BITS)) - 1)) == 0)
+        cascade(l);
+  }
+}
+
+double TimingWheel::earliest(int s) const
+{
+  double best = -1;
+  for (int id = slots[s]; id != -1; id = timers[id].next)
+    if (best < 0 || timers[id].deadline < best)
+      best = timers[id].deadline;
+  return best;
+}
+
+void TimingWheel::expire(double now, double deadline, std::vector<int> &expired)
+{
+  advance(now > deadline ? now : deadline, expired);
+}
+
+double TimingWheel::next_expiry() const
+{
+  double best = -1;
+
+  /* the first non-empty slot of each level, in wheel order, holds that */
+  /* level's earliest timer; levels can overlap in time, so check all  */
+  for (int l = 0; l < WHEEL_LEVELS; l++)
+  {
+    if (occupied[l] == 0)
+      continue;
+    int start = (int)((cur >> (l * WHEEL_BITS)) & (WHEEL_SLOTS - 1));
+    uint64_t ahead = (start == 0) ? occupied[l]
+                     : (occupied[l] >> start) | (occupied[l] << (WHEEL_SLOTS - start));
+    int s = (start + __builtin_ctzll(ahead)) & (WHEEL_SLOTS - 1);
+    double t = earliest(l * WHEEL_SLOTS + s);
+    if (best < 0 || t < best)
+      best = t;
+  }
+  double t = earliest(OVERFLOW_SLOT);
+  if (t >= 0 && (best < 0 || t < best))
+    best = t;
+  return best;
+}
@@ -0,0 +1,165 @@
+#include "../include/trace.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_MAGIC   "RDTTRACE"
+#define TRACE_VERSION 1
+
+/**************************** TEXT FORMAT ***************************/
+
+static void print_chars(FILE *out, const char *data)
+{
+  fwrite(data, 1, 20, out);
+  fputc('\n', out);
+}
+
+void trace_print(FILE *out, const struct trace_record &r)
+{
+  switch (r.kind)
+  {
+    case TR_EVENT:
+      fprintf(out, "\nEVENT time: %f,", r.evtime);
+      fprintf(out, "  type: %d", r.evtype);
+      if (r.evtype == 0)
+        fprintf(out, ", timerinterrupt  ");
+      else if (r.evtype == 1)
+        fprintf(out, ", fromlayer5 ");
+      else
+        fprintf(out, ", fromlayer3 ");
+      fprintf(out, " entity: %d\n", r.entity);
+      break;
+    case TR_MAINLOOP:
+      fprintf(out, "          MAINLOOP: data given to student: ");
+      print_chars(out, r.packet.payload);
+      break;
+    case TR_INSERT:
+      fprintf(out, "            INSERTEVENT: time is %lf\n", r.time);
+      fprintf(out, "            INSERTEVENT: future time will be %lf\n", r.evtime);
+      break;
+    case TR_ARRIVAL:
+      fprintf(out, "          GENERATE NEXT ARRIVAL: creating new arrival\n");
+      break;
+    case TR_STOPTIMER:
+      fprintf(out, "          STOP TIMER: stopping timer at %f\n", r.time);
+      break;
+    case TR_STARTTIMER:
+      fprintf(out, "          START TIMER: starting timer at %f\n", r.time);
+      break;
+    case TR_LOST:
+      fprintf(out, "          TOLAYER3: packet being lost\n");
+      break;
+    case TR_TOLAYER3:
+      fprintf(out, "          TOLAYER3: seq: %d, ack %d, check: %d ", r.packet.seqnum,
+              r.packet.acknum, r.packet.checksum);
+      print_chars(out, r.packet.payload);
+      break;
+    case TR_CORRUPT:
+      fprintf(out, "          TOLAYER3: packet being corrupted\n");
+      break;
+    case TR_SCHEDULE:
+      fprintf(out, "          TOLAYER3: scheduling arrival on other side\n");
+      break;
+    case TR_TOLAYER5:
+      fprintf(out, "          TOLAYER5: data received: ");
+      print_chars(out, r.packet.payload);
+      break;
+    case TR_DROPPED:
+      fprintf(out, "          TOLAYER3: packet dropped by the link's queue\n");
+      break;
+    default:
+      fprintf(out, "TRACE: unknown record kind %d\n", r.kind);
+  }
+}
+
+/**************************** TRACE FILE ****************************/
+
+TraceRing::~TraceRing()
+{
+  if (header != NULL)
+    munmap(header, length);
+}
+
+int TraceRing::create(const char *path, uint64_t capacity)
+{
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  length = sizeof(struct trace_file_header) + capacity * sizeof(struct trace_record);
+  if (ftruncate(fd, length) != 0)
+  {
+    perror(path);
+    ::close(fd);
+    return -1;
+  }
+  void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    perror(path);
+    return -1;
+  }
+
+  header = (struct trace_file_header *)map;
+  ring = (struct trace_record *)(header + 1);
+  memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+  header->version = TRACE_VERSION;
+  header->record_size = sizeof(struct trace_record);
+  header->capacity = capacity;
+  header->count = 0;
+  return 0;
+}
+
+int TraceRing::open(const char *path)
+{
+  struct stat st;
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    perror(path);
+    if (fd >= 0)
+      ::close(fd);
+    return -1;
+  }
+  length = st.st_size;
+  void *map = (length >= sizeof(struct trace_file_header))
+              ? mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    fprintf(stderr, "%s: not a trace file\n", path);
+    return -1;
+  }
+
+  header = (struct trace_file_header *)map;
+  ring = (struct trace_record *)(header + 1);
+  if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != TRACE_VERSION ||
+      header->record_size != sizeof(struct trace_record) ||
+      length < sizeof(struct trace_file_header) + header->capacity * sizeof(struct trace_record))
+  {
+    fprintf(stderr, "%s: not a trace file\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+uint64_t TraceRing::size() const
+{
+  return header->count < header->capacity ? header->count : header->capacity;
+}
+
+uint64_t TraceRing::overwritten() const
+{
+  return header->count - size();
+}
+
+const struct trace_record &TraceRing::at(uint64_t i) const
+{
+  return ring[(overwritten() + i) & (header->capacity - 1)];
+}
@@ -0,0 +1,23 @@
+#include "../include/trace.h"
+#include <stdio.h>
+
+/* Render a binary trace written with -b as the emulator's text trace */
+int main(int argc, char **argv)
+{
+  TraceRing trace;
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage:\n %s Trace file\n", argv[0]);
+    return -1;
+  }
+  if (trace.open(argv[1]) != 0)
+    return -1;
+
+  if (trace.overwritten() > 0)
+    fprintf(stderr, "%llu older records were overwritten\n",
+            (unsigned long long)trace.overwritten());
+  for (uint64_t i = 0; i < trace.size(); i++)
+    trace_print(stdout, trace.at(i));
+  return 0;
+}
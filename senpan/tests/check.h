@@ -0,0 +1,33 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+/* Reference checks run by make test.  CHECK() reports a failed condition */
+/* with its place and a printf-style message and counts it; a test ends  */
+/* with return report(name), which exits non-zero if anything failed.    */
+static int failures = 0;
+
+#define CHECK(cond, ...)                                        \
+  do                                                            \
+  {                                                             \
+    if (!(cond) && failures++ < 20)                             \
+    {                                                           \
+      printf("%s:%d: %s failed: ", __FILE__, __LINE__, #cond);  \
+      printf(__VA_ARGS__);                                      \
+      printf("\n");                                             \
+    }                                                           \
+  } while (0)
+
+static int report(const char *name)
+{
+  if (failures > 0)
+  {
+    printf("[TEST]%s: %d checks failed[/TEST]\n", name, failures);
+    return 1;
+  }
+  printf("[TEST]%s: ok[/TEST]\n", name);
+  return 0;
+}
+
+#endif
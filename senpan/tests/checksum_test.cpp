@@ -0,0 +1,171 @@
+#include "../include/checksum.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/* ******************************************************************
+ CHECKSUM REFERENCE CHECKS
+
+   The CRC32C check value and the RFC 1071 example, each fast path
+   against a plain byte-at-a-time reference, and the detection the
+   README claims: inet and crc32c catch every single flipped bit of a
+   20-byte data packet, crc32c every pair as well, tried bit by bit,
+   and every 3 and 4 bits flipped as --bitflip flips them.  sum8
+   misses exactly the flips in the bytes it does not cover.
+**********************************************************************/
+
+#define TRIALS 20000
+
+/* RFC 1071 one word at a time, in host order like inet_checksum() */
+uint16_t inet_reference(const unsigned char *b, size_t len)
+{
+  uint32_t sum = 0;
+  for (size_t i = 0; i + 1 < len; i += 2)
+  {
+    uint16_t w;
+    memcpy(&w, b + i, 2);
+    sum += w;
+  }
+  if (len % 2)
+  {
+    uint16_t w = 0;
+    memcpy(&w, b + len - 1, 1);
+    sum += w;
+  }
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return ~sum & 0xffff;
+}
+
+/* CRC32C one bit at a time, reflected polynomial 0x82f63b78 */
+uint32_t crc32c_reference(const unsigned char *b, size_t len)
+{
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= b[i];
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+void check_algorithms()
+{
+  CHECK(crc32c(0, "123456789", 9) == 0xe3069283, "CRC32C check value");
+  CHECK(crc32c_table(0, "123456789", 9) == 0xe3069283, "CRC32C check value of the table");
+
+  /* RFC 1071 section 3: 00 01 f2 03 f4 f5 f6 f7 sums to ddf2 in network */
+  /* order; the sum is the same in either byte order, swapped           */
+  unsigned char example[] = {0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7};
+  uint16_t sum = ~inet_checksum(example, sizeof(example), 0) & 0xffff;
+  uint16_t one = 1;
+  bool little = *(unsigned char *)&one == 1;
+  CHECK(sum == (little ? 0xf2dd : 0xddf2), "RFC 1071 example: %04x", sum);
+
+  /* every length and alignment of the fast paths */
+  std::vector<unsigned char> buffer(2048 + 16);
+  for (size_t i = 0; i < buffer.size(); i++)
+    buffer[i] = rand();
+  for (int len = 0; len <= 2048; len += (len < 80 ? 1 : 37))
+    for (int align = 0; align < 8; align++)
+    {
+      const unsigned char *b = &buffer[align];
+      CHECK(inet_checksum(b, len, 0) == inet_reference(b, len), "inet over %d bytes at +%d", len, align);
+      CHECK(crc32c_table(0, b, len) == crc32c_reference(b, len), "crc32c table over %d bytes at +%d", len, align);
+      if (crc32c_hardware != NULL)
+        CHECK(crc32c_hardware(0, b, len) == crc32c_reference(b, len), "crc32c SSE4.2 over %d bytes at +%d", len,
+              align);
+      /* chained as zlib's crc32() is */
+      int half = len / 3;
+      CHECK(crc32c(crc32c(0, b, half), b + half, len - half) == crc32c_reference(b, len),
+            "crc32c chained over %d bytes at +%d", len, align);
+    }
+}
+
+struct pkt data_paket(int kind)
+{
+  struct pkt p;
+  memset(&p, 0, sizeof(p));
+  p.seqnum = rand() % 16;
+  p.acknum = 0;
+  p.length = 20;
+  memset(p.payload, 'a' + rand() % 26, 20);
+  p.checksum = paket_checksum(kind, p);
+  return p;
+}
+
+/* the receiver takes q for a good packet */
+bool passes(int kind, const struct pkt &q)
+{
+  return q.checksum == paket_checksum(kind, q);
+}
+
+void flip(struct pkt &p, int bit)
+{
+  ((unsigned char *)&p)[bit / 8] ^= 1 << (bit % 8);
+}
+
+void check_detection()
+{
+  int bits = 8 * (PKT_HEADER + 20);
+
+  /* every single bit, and for crc32c every pair */
+  for (int kind = 0; kind < 3; kind++)
+  {
+    struct pkt p = data_paket(kind);
+    int missed = 0;
+    for (int b = 0; b < bits; b++)
+    {
+      struct pkt q = p;
+      flip(q, b);
+      /* sum8 covers the low bytes of seqnum and acknum, the checksum */
+      /* itself and the payload, nothing else                          */
+      bool covered = b < 8 || (b >= 32 && b < 40) || (b >= 64 && b < 96) || b >= 8 * PKT_HEADER;
+      if (passes(kind, q))
+      {
+        missed++;
+        CHECK(kind == CHECKSUM_SUM8 && !covered, "%s misses bit %d", checksum_names[kind], b);
+      }
+      else
+        CHECK(kind != CHECKSUM_SUM8 || covered, "sum8 catches bit %d it does not cover", b);
+    }
+    if (kind == CHECKSUM_SUM8)
+      CHECK(missed == 80, "sum8 missed %d single flips, expected 80", missed);
+  }
+  struct pkt p = data_paket(CHECKSUM_CRC32C);
+  for (int b1 = 0; b1 < bits; b1++)
+    for (int b2 = b1 + 1; b2 < bits; b2++)
+    {
+      struct pkt q = p;
+      flip(q, b1);
+      flip(q, b2);
+      CHECK(!passes(CHECKSUM_CRC32C, q), "crc32c misses bits %d and %d", b1, b2);
+    }
+
+  /* more bits as --bitflip flips them: each time that many, distinct */
+  SimRandom *rng = make_random("xoshiro", 1);
+  for (int n = 1; n <= 4; n++)
+    for (int t = 0; t < TRIALS; t++)
+    {
+      struct pkt p = data_paket(CHECKSUM_CRC32C);
+      struct pkt q = p;
+      flip_bits(q, PKT_HEADER + q.length, n, rng);
+      int changed = 0;
+      for (int b = 0; b < 8 * (int)sizeof(q); b++)
+        changed += (((unsigned char *)&p)[b / 8] ^ ((unsigned char *)&q)[b / 8]) >> (b % 8) & 1;
+      CHECK(changed == n && memcmp(&p.payload[20], &q.payload[20], sizeof(p.payload) - 20) == 0,
+            "flip_bits flipped %d bits for %d", changed, n);
+      CHECK(!passes(CHECKSUM_CRC32C, q), "crc32c misses %d flipped bits", n);
+    }
+  delete rng;
+}
+
+int main()
+{
+  srand(1);
+  check_algorithms();
+  check_detection();
+  return report("checksums");
+}
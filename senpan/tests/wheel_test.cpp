@@ -0,0 +1,120 @@
+#include "../include/timing_wheel.h"
+#include "check.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+/* ******************************************************************
+ TIMING WHEEL REFERENCE CHECKS
+
+   Random arm, cancel and advance sequences against a brute-force
+   wheel: a plain array of deadlines scanned in full.  After every
+   advance the timers handed back must be exactly those due, in tick
+   order, and next_expiry() the earliest deadline left.  Timer
+   lengths run from under a tick to past the top level, so timers
+   cascade down the levels and wait on the overflow list.
+**********************************************************************/
+
+#define TIMERS 256
+#define STEPS  200000
+
+double uniform() { return rand() / (RAND_MAX + 1.0); }
+
+/* a timer length: mostly short, now and then past any level */
+double length()
+{
+  double top = pow(WHEEL_SLOTS, WHEEL_LEVELS);
+  switch (rand() % 4)
+  {
+    case 0:  return uniform() * 2;
+    case 1:  return uniform() * WHEEL_SLOTS * 2;
+    case 2:  return uniform() * WHEEL_SLOTS * WHEEL_SLOTS * 2;
+    default: return uniform() * top * 2;
+  }
+}
+
+void check_wheel(double tick)
+{
+  TimingWheel wheel(TIMERS, tick);
+  std::vector<double> deadline(TIMERS, -1);   /* -1 if not armed */
+  std::vector<int> expired;
+  double now = 0;
+
+  for (int step = 0; step < STEPS; step++)
+  {
+    int id = rand() % TIMERS;
+    int op = rand() % 8;
+    if (op < 4)
+    {
+      deadline[id] = now + length() * tick;
+      wheel.arm(id, deadline[id]);
+    }
+    else if (op < 5)
+    {
+      deadline[id] = -1;
+      wheel.cancel(id);
+    }
+    else
+    {
+      /* step forward, to the next deadline or a little past it */
+      double first = wheel.next_expiry();
+      if (op == 5 && first >= 0)
+        now = first;
+      else if (op == 6 && first >= 0)
+        now = first + uniform() * tick * 3;
+      else
+        now += length() * tick / 16;
+
+      expired.clear();
+      if (op == 5 && first >= 0)
+        /* the physical timer set for first goes off a hair early */
+        wheel.expire(now - tick / 1000, first, expired);
+      else
+        wheel.advance(now, expired);
+
+      std::vector<bool> handed(TIMERS, false);
+      for (size_t i = 0; i < expired.size(); i++)
+      {
+        int e = expired[i];
+        CHECK(deadline[e] >= 0 && deadline[e] <= now, "tick %g step %d: timer %d due at %f handed back at %f",
+              tick, step, e, deadline[e], now);
+        CHECK(!handed[e], "tick %g step %d: timer %d handed back twice", tick, step, e);
+        CHECK(i == 0 || floor(deadline[expired[i - 1]] / tick) <= floor(deadline[e] / tick),
+              "tick %g step %d: timer %d out of tick order", tick, step, e);
+        handed[e] = true;
+      }
+      for (int t = 0; t < TIMERS; t++)
+      {
+        CHECK(handed[t] || deadline[t] < 0 || deadline[t] > now, "tick %g step %d: timer %d due at %f kept at %f",
+              tick, step, t, deadline[t], now);
+        if (handed[t])
+          deadline[t] = -1;
+      }
+    }
+
+    double first = -1;
+    size_t armed = 0;
+    for (int t = 0; t < TIMERS; t++)
+    {
+      CHECK(wheel.armed(t) == (deadline[t] >= 0), "tick %g step %d: armed(%d)", tick, step, t);
+      if (deadline[t] < 0)
+        continue;
+      CHECK(wheel.deadline(t) == deadline[t], "tick %g step %d: deadline(%d)", tick, step, t);
+      armed++;
+      if (first < 0 || deadline[t] < first)
+        first = deadline[t];
+    }
+    CHECK(wheel.size() == armed, "tick %g step %d: size() %lu, expected %lu", tick, step,
+          (unsigned long)wheel.size(), (unsigned long)armed);
+    CHECK(wheel.next_expiry() == first, "tick %g step %d: next_expiry() %f, expected %f", tick, step,
+          wheel.next_expiry(), first);
+  }
+}
+
+int main()
+{
+  srand(1);
+  check_wheel(1.0);
+  check_wheel(0.25);
+  return report("timing wheel");
+}
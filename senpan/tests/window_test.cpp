@@ -0,0 +1,152 @@
+#include "../include/send_window.h"
+#include "../include/recv_window.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+#include <set>
+
+/* ******************************************************************
+ SR WINDOW REFERENCE CHECKS
+
+   Drives SendWindow and RecvWindow through random sends, ACKs and
+   arrivals next to a std::list and a std::set that hold what each
+   window must hold, and compares everything either one can tell
+   after every step; the checks that walk the whole window only every
+   wind_size/64 steps.  Window sizes go from 1 to 1000, including
+   sizes that are not multiples of 64.
+**********************************************************************/
+
+#define STEPS 20000
+
+struct pkt make_pkt(int seqnum)
+{
+  struct pkt p;
+  memset(&p, 0, sizeof(p));
+  p.seqnum = seqnum;
+  p.length = 20;
+  memset(p.payload, 'a' + seqnum % 26, 20);
+  return p;
+}
+
+/* SendWindow against the seqnums unACKed in send order */
+void check_send_window(int wind_size)
+{
+  int max_seqnum = 2 * wind_size;
+  SendWindow window(max_seqnum);
+  std::list<int> unacked;
+  int next_seqnum = 0, oldest = 0;
+
+  for (int step = 0; step < STEPS; step++)
+  {
+    int in_flight = (next_seqnum - oldest + max_seqnum) % max_seqnum;
+    if (in_flight < wind_size && rand() % 2)
+    {
+      window.add(make_pkt(next_seqnum));
+      unacked.push_back(next_seqnum);
+      next_seqnum = (next_seqnum + 1) % max_seqnum;
+    }
+    else
+    {
+      int seqnum = rand() % max_seqnum;
+      bool expected = false;
+      for (std::list<int>::iterator it = unacked.begin(); it != unacked.end(); ++it)
+        if (*it == seqnum)
+        {
+          unacked.erase(it);
+          expected = true;
+          break;
+        }
+      CHECK(window.ack(seqnum) == expected, "window %d: ACK of %d", wind_size, seqnum);
+    }
+    /* the window slides past the packets ACKed from its base on */
+    oldest = unacked.empty() ? next_seqnum : unacked.front();
+
+    CHECK(window.empty() == unacked.empty(), "window %d step %d", wind_size, step);
+    CHECK(window.base() == (unacked.empty() ? -1 : unacked.front()), "window %d step %d: base %d", wind_size,
+          step, window.base());
+    if (step % (1 + wind_size / 64))
+      continue;
+    int seqnum = window.base();
+    for (std::list<int>::iterator it = unacked.begin(); it != unacked.end(); ++it)
+    {
+      CHECK(seqnum == *it, "window %d step %d: %d in send order, expected %d", wind_size, step, seqnum, *it);
+      CHECK(window.packet(*it).seqnum == *it && window.packet(*it).payload[0] == 'a' + *it % 26,
+            "window %d step %d: packet %d", wind_size, step, *it);
+      seqnum = window.next(*it);
+    }
+    CHECK(seqnum == -1, "window %d step %d: %d past the last unACKed", wind_size, step, seqnum);
+    std::set<int> members(unacked.begin(), unacked.end());
+    for (int s = -1; s <= max_seqnum; s++)
+      CHECK(window.contains(s) == (members.count(s) > 0), "window %d step %d: contains(%d)", wind_size, step, s);
+  }
+}
+
+/* RecvWindow against the set of seqnums buffered */
+void check_recv_window(int wind_size)
+{
+  int max_seqnum = 2 * wind_size;
+  RecvWindow window(wind_size, max_seqnum);
+  std::set<int> buffered;
+  int base = 0;
+  int nbits = wind_size + 8;
+  std::vector<char> bits((nbits + 7) / 8);
+
+  for (int step = 0; step < STEPS; step++)
+  {
+    /* a packet from anywhere in the sequence space arrives; the window */
+    /* keeps it if it is in the window and new                          */
+    int seqnum = rand() % max_seqnum;
+    int offset = (seqnum - base + max_seqnum) % max_seqnum;
+    CHECK(window.in_window(seqnum) == (offset < wind_size), "window %d: in_window(%d), base %d", wind_size,
+          seqnum, base);
+    if (offset < wind_size && !buffered.count(seqnum))
+    {
+      window.add(make_pkt(seqnum));
+      buffered.insert(seqnum);
+    }
+
+    /* the run from the base on */
+    int run = 0;
+    while (run < wind_size && buffered.count((base + run) % max_seqnum))
+      run++;
+    CHECK(window.ready() == run, "window %d step %d: ready() %d, expected %d", wind_size, step, window.ready(),
+          run);
+    CHECK(window.empty() == buffered.empty(), "window %d step %d", wind_size, step);
+    CHECK(window.base() == base, "window %d step %d: base %d, expected %d", wind_size, step, window.base(), base);
+    if (step % (1 + wind_size / 64) == 0)
+    {
+      for (int s = 0; s < max_seqnum; s++)
+        CHECK(window.contains(s) == (buffered.count(s) > 0), "window %d step %d: contains(%d)", wind_size, step, s);
+
+      window.sack(&bits[0], nbits);
+      for (int i = 0; i < nbits; i++)
+      {
+        bool expected = i < wind_size - 1 && buffered.count((base + 1 + i) % max_seqnum);
+        CHECK(((bits[i >> 3] >> (i & 7)) & 1) == expected, "window %d step %d: SACK bit %d", wind_size, step, i);
+      }
+    }
+
+    /* deliver some of the run */
+    int deliver = run > 0 ? rand() % (run + 1) : 0;
+    for (int k = 0; k < deliver; k++)
+    {
+      CHECK(window.packet(base).seqnum == base, "window %d step %d: packet at the base", wind_size, step);
+      window.pop();
+      buffered.erase(base);
+      base = (base + 1) % max_seqnum;
+    }
+  }
+}
+
+int main()
+{
+  int sizes[] = {1, 2, 3, 8, 63, 64, 65, 100, 127, 128, 129, 500, 1000};
+  srand(1);
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    check_send_window(sizes[i]);
+    check_recv_window(sizes[i]);
+  }
+  return report("SR windows");
+}